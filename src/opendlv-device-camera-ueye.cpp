@@ -14,20 +14,73 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
 #include <cstdint>
 #include <cstring>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
 
+#include <sys/stat.h>
 #include <X11/Xlib.h>
-#include <opencv/cv.hpp>
-#include <libyuv.h>
 
 #include "cluon-complete.hpp"
 
 #include "pixelink/camera.h"
 #include "pixelink/pixelFormat.h"
+#include "pipeline/bayerConverter.h"
+#include "pipeline/bayerCorrection.h"
+#include "pipeline/bayerDownsampler.h"
+#include "pipeline/colourCorrection.h"
+#include "pipeline/frameClock.h"
+#include "pipeline/frameConverter.h"
+#include "pipeline/frameCounters.h"
+#include "pipeline/framePacer.h"
+#include "pipeline/frameTime.h"
+#include "pipeline/latencyStats.h"
+#include "pipeline/monoConverter.h"
+#include "pipeline/pyramid.h"
+#include "pipeline/spscRing.h"
+#include "pipeline/telemetry.h"
+#include "pipeline/tensorWriter.h"
+#include "pipeline/toneMapper.h"
+#include "pipeline/workerPool.h"
+#include "pipeline/yuv422Converter.h"
+
+namespace {
+
+// Runs a function when leaving the scope it is declared in, e.g., to stop
+// the camera on every way out of main.
+class ScopeGuard {
+   private:
+    ScopeGuard(const ScopeGuard &) = delete;
+    ScopeGuard(ScopeGuard &&)      = delete;
+    ScopeGuard &operator=(const ScopeGuard &) = delete;
+    ScopeGuard &operator=(ScopeGuard &&) = delete;
+
+   public:
+    explicit ScopeGuard(std::function<void()> onExit)
+        : m_onExit{std::move(onExit)} {}
+    ~ScopeGuard() {
+        m_onExit();
+    }
+
+   private:
+    std::function<void()> m_onExit;
+};
+
+}  // namespace
 
 int32_t main(int32_t argc, char **argv) {
     int32_t retCode{0};
@@ -36,20 +89,84 @@ int32_t main(int32_t argc, char **argv) {
          (0 == commandlineArguments.count("height")) ||
          (0 == commandlineArguments.count("freq")) ) {
         std::cerr << argv[0] << " interfaces with the given IDS uEye camera (e.g., UI122xLE-M) and provides the captured image in two shared memory areas: one in I420 format and one in ARGB format." << std::endl;
-        std::cerr << "Usage:   " << argv[0] << " --width=<width> --height=<height> [--pixel_clock=<value>] [--name.i420=<unique name for the shared memory in I420 format>] [--name.argb=<unique name for the shared memory in ARGB format>] [--verbose]" << std::endl;
+        std::cerr << "Usage:   " << argv[0] << " --width=<width> --height=<height> [--left=<column>] [--top=<row>] [--binning=<factor>|--decimation=<factor>|--averaging=<factor>] [--pixel_clock=<value>] [--name.i420=<unique name for the shared memory in I420 format>] [--name.argb=<unique name for the shared memory in ARGB format>] [--name.telemetry=<unique name for the shared memory with telemetry>] [--name.raw16=<unique name for the shared memory with 16 bit Bayer frames>] [--name.tensor=<unique name for the shared memory with the neural network input tensor>] [--name.rgb=<unique name for the shared memory with small RGB24 images>] [--name.nv12=<unique name for the shared memory in NV12 format>] [--name.gray=<unique name for the shared memory in GRAY8 format>] [--buffers=<number>] [--stripes=<number>] [--demosaic=<bilinear|superpixel>] [--tonemap=<compression>] [--tonemap.exposure=<ms>] [--tonemap.tiles=<number>] [--tonemap.strength=<value>] [--isp.black=<level>] [--isp.defects=<file>] [--isp.shading=<file>] [--colour=<file>] [--yuv.matrix=<bt601|bt709>] [--yuv.range=<limited|full>] [--pyramid=<levels>] [--tensor=<width>x<height>] [--tensor.type=<uint8|float16>] [--tensor.mean=<r>,<g>,<b>] [--tensor.std=<r>,<g>,<b>] [--tensor.pad=<value>] [--tensor.bgr] [--rgb=<width>x<height>] [--nv12] [--gray] [--acquisition=<poll|callback>] [--stats=<seconds>] [--timestamp=<camera|host>] [--mid_exposure] [--verbose]" << std::endl;
         std::cerr << "         --name.i420:   name of the shared memory for the I420 formatted image; when omitted, 'ueye.i420' is chosen" << std::endl;
         std::cerr << "         --name.argb:   name of the shared memory for the I420 formatted image; when omitted, 'ueye.argb' is chosen" << std::endl;
+        std::cerr << "         --name.telemetry: name of the shared memory for per-frame telemetry (e.g., camera clock offset and skew); when omitted, 'ueye.telemetry' is chosen" << std::endl;
+        std::cerr << "         --name.raw16:  name of the shared memory for unpacked 16 bit Bayer frames (host byte order, significant bits at the top) from 12 or 16 bit pixel formats; when omitted, none is published" << std::endl;
+        std::cerr << "         --name.tensor: name of the shared memory for the neural network input tensor; when omitted, 'ueye.tensor' is chosen" << std::endl;
+        std::cerr << "         --name.rgb:    name of the shared memory for the small RGB24 images; when omitted, 'ueye.rgb' is chosen" << std::endl;
+        std::cerr << "         --name.nv12:   name of the shared memory for the NV12 formatted image; when omitted, 'ueye.nv12' is chosen" << std::endl;
+        std::cerr << "         --name.gray:   name of the shared memory for the GRAY8 formatted image; when omitted, 'ueye.gray' is chosen" << std::endl;
         std::cerr << "         --pixel_clock: desired pixel clock (default: 10)" << std::endl;
-        std::cerr << "         --width:       desired width of a frame" << std::endl;
-        std::cerr << "         --height:      desired height of a frame" << std::endl;
-        std::cerr << "         --freq:        desired frequency" << std::endl;
+        std::cerr << "         --width:       desired width of a frame; applied as region of interest on the sensor" << std::endl;
+        std::cerr << "         --height:      desired height of a frame; applied as region of interest on the sensor" << std::endl;
+        std::cerr << "         --left:        first sensor column of the region of interest (default: centered)" << std::endl;
+        std::cerr << "         --top:         first sensor row of the region of interest (default: centered)" << std::endl;
+        std::cerr << "         --binning:     combine factor x factor sensor pixels into one on the camera (e.g., 2); frames are width/factor x height/factor" << std::endl;
+        std::cerr << "         --decimation:  read only every factor-th sensor pixel in both directions" << std::endl;
+        std::cerr << "         --averaging:   average factor x factor sensor pixels into one" << std::endl;
+        std::cerr << "         --freq:        desired frequency; set on the camera if supported, surplus frames are skipped before conversion" << std::endl;
+        std::cerr << "         --buffers:     number of raw frames that can be queued between capturing and converting (default: 4)" << std::endl;
+        std::cerr << "         --stripes:     number of horizontal stripes of a frame that are converted in parallel (default: number of CPU cores)" << std::endl;
+        std::cerr << "         --demosaic:    bilinear: full resolution (default); superpixel: one pixel per 2x2 Bayer cell, half width and height" << std::endl;
+        std::cerr << "         --tonemap:     map 12 and 16 bit frames to the 8 bit images with a logarithmic curve of the given compression (default: 8; 0 is linear) instead of dropping the lower bits" << std::endl;
+        std::cerr << "         --tonemap.exposure: reference exposure in ms; frames are scaled by it over their exposure before tone mapping (default: 0, disabled)" << std::endl;
+        std::cerr << "         --tonemap.tiles: brighten dark and darken bright regions of a grid of tiles x tiles tiles (at most 64; default: 0, disabled)" << std::endl;
+        std::cerr << "         --tonemap.strength: strength of the regional adjustment in [0, 1] (default: 0.5)" << std::endl;
+        std::cerr << "         --isp.black:   black level of Bayer frames in the pixel format's bit depth; subtracted before demosaicing (default: 0)" << std::endl;
+        std::cerr << "         --isp.defects: text file with the defective pixels of Bayer frames, one 'x y' per line; replaced before demosaicing" << std::endl;
+        std::cerr << "         --isp.shading: text file with lens shading gains for Bayer frames: 'columns rows' of a grid spread over the frame, then four gains per node for the 2x2 Bayer cell, row by row" << std::endl;
+        std::cerr << "         --colour:      text file with white balance ('white_balance r g b'), colour correction matrix ('matrix' and 9 values, row by row), and gamma ('gamma g') applied in software to Bayer frames; reloaded while running when it changes. The camera's own gamma and white balance are then turned off" << std::endl;
+        std::cerr << "         --yuv.matrix:  colour matrix of the I420 image: bt601 (default) or bt709; recorded in the telemetry" << std::endl;
+        std::cerr << "         --yuv.range:   range of the I420 image: limited (default; Y in [16, 235]) or full ([0, 255]; default for mono frames, which are then published unchanged); recorded in the telemetry" << std::endl;
+        std::cerr << "         --pyramid:     number of further I420 images at 1/2, 1/4, ... of the width and height (at most 4; default: 0); published in shared memory '<name.i420>.2', '<name.i420>.4', ..." << std::endl;
+        std::cerr << "         --tensor:      publish the image as planar RGB input tensor (NCHW) of the given size, resized with unchanged aspect ratio and padded (letterbox), behind a header with its shape and type" << std::endl;
+        std::cerr << "         --tensor.type: element type of the tensor: uint8 (default) or float16" << std::endl;
+        std::cerr << "         --tensor.mean: per channel mean subtracted from float16 tensors, for values in [0, 1] (default: 0,0,0)" << std::endl;
+        std::cerr << "         --tensor.std:  per channel standard deviation float16 tensors are divided by (default: 1,1,1)" << std::endl;
+        std::cerr << "         --tensor.pad:  value of the padding in [0, 255] (default: 114)" << std::endl;
+        std::cerr << "         --tensor.bgr:  order the channels of the tensor B, G, R" << std::endl;
+        std::cerr << "         --rgb:         publish RGB24 images of the given size (at most half the frame's width and height) averaged straight from the Bayer frame, without demosaicing and without corrections" << std::endl;
+        std::cerr << "         --nv12:        also publish the image in NV12 format" << std::endl;
+        std::cerr << "         --gray:        also publish the image's luma alone in GRAY8 format" << std::endl;
+        std::cerr << "         --acquisition: poll: read frames on a capture thread (default); callback: receive frames from the SDK's frame callback, which saves the capture thread's wake-up but still copies every frame out of the SDK's buffer" << std::endl;
+        std::cerr << "         --stats:       print acquisition statistics every given number of seconds (default: 0, disabled)" << std::endl;
+        std::cerr << "         --timestamp:   camera: stamp frames with the camera's frame time mapped onto the host clock (default); host: stamp frames when they are published" << std::endl;
+        std::cerr << "         --mid_exposure: move camera timestamps from the start to the middle of the exposure" << std::endl;
         std::cerr << "         --verbose:     display captured image" << std::endl;
         std::cerr << "Example: " << argv[0] << " --width=752 --height=480 --pixel_clock=10 --freq=20 --verbose" << std::endl;
         retCode = 1;
     }
     else {
-//        const uint32_t WIDTH{static_cast<uint32_t>(std::stoi(commandlineArguments["width"]))};
-//        const uint32_t HEIGHT{static_cast<uint32_t>(std::stoi(commandlineArguments["height"]))};
+        const int32_t REQUESTED_WIDTH{std::stoi(commandlineArguments["width"])};
+        const int32_t REQUESTED_HEIGHT{std::stoi(commandlineArguments["height"])};
+        if ( (REQUESTED_WIDTH <= 0) || (REQUESTED_HEIGHT <= 0) || (0 != (REQUESTED_WIDTH % 2)) || (0 != (REQUESTED_HEIGHT % 2)) ) {
+            std::cerr << "[opendlv-device-camera-ueye]: width and height must be positive and even; found " << REQUESTED_WIDTH << "x" << REQUESTED_HEIGHT << "." << std::endl;
+            return retCode = 1;
+        }
+        // Pixel addressing reduces the resolution on the camera.
+        float pixelAddressingMode{PIXEL_ADDRESSING_MODE_BIN};
+        uint32_t pixelAddressingFactor{PIXEL_ADDRESSING_VALUE_NONE};
+        {
+            uint32_t modes{0};
+            for (auto mode : {std::make_pair("binning", PIXEL_ADDRESSING_MODE_BIN),
+                              std::make_pair("decimation", PIXEL_ADDRESSING_MODE_DECIMATE),
+                              std::make_pair("averaging", PIXEL_ADDRESSING_MODE_AVERAGE)}) {
+                if (commandlineArguments[mode.first].size() != 0) {
+                    pixelAddressingMode = static_cast<float>(mode.second);
+                    pixelAddressingFactor = static_cast<uint32_t>(std::stoi(commandlineArguments[mode.first]));
+                    modes++;
+                }
+            }
+            if ( (1 < modes) || (0 == pixelAddressingFactor) ) {
+                std::cerr << "[opendlv-device-camera-ueye]: Only one of binning, decimation, or averaging can be given, with a factor larger than 0." << std::endl;
+                return retCode = 1;
+            }
+        }
+
+        const int32_t LEFT{(commandlineArguments["left"].size() != 0) ? std::stoi(commandlineArguments["left"]) : PXL_ROI::CENTERED};
+        const int32_t TOP{(commandlineArguments["top"].size() != 0) ? std::stoi(commandlineArguments["top"]) : PXL_ROI::CENTERED};
         const bool VERBOSE{commandlineArguments.count("verbose") != 0};
         const uint32_t PIXEL_CLOCK{(commandlineArguments["pixel_clock"].size() != 0) ?static_cast<uint32_t>(std::stoi(commandlineArguments["pixel_clock"])) : 10};
 
@@ -59,6 +176,126 @@ int32_t main(int32_t argc, char **argv) {
             return retCode = 1;
         }
 
+        const uint32_t BUFFERS{(commandlineArguments["buffers"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["buffers"])) : 4};
+        if (0 == BUFFERS) {
+            std::cerr << "[opendlv-device-camera-ueye]: buffers must be larger than 0." << std::endl;
+            return retCode = 1;
+        }
+
+        const uint32_t STRIPES{(commandlineArguments["stripes"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["stripes"])) : std::max(1u, std::thread::hardware_concurrency())};
+        if (0 == STRIPES) {
+            std::cerr << "[opendlv-device-camera-ueye]: stripes must be larger than 0." << std::endl;
+            return retCode = 1;
+        }
+
+        const std::string DEMOSAIC{(commandlineArguments["demosaic"].size() != 0) ? commandlineArguments["demosaic"] : "bilinear"};
+        if ( ("bilinear" != DEMOSAIC) && ("superpixel" != DEMOSAIC) ) {
+            std::cerr << "[opendlv-device-camera-ueye]: demosaic must be either bilinear or superpixel; found " << DEMOSAIC << "." << std::endl;
+            return retCode = 1;
+        }
+        const Demosaic DEMOSAIC_MODE{("superpixel" == DEMOSAIC) ? Demosaic::SUPERPIXEL : Demosaic::BILINEAR};
+
+        const std::string YUV_MATRIX{(commandlineArguments["yuv.matrix"].size() != 0) ? commandlineArguments["yuv.matrix"] : "bt601"};
+        if ( ("bt601" != YUV_MATRIX) && ("bt709" != YUV_MATRIX) ) {
+            std::cerr << "[opendlv-device-camera-ueye]: yuv.matrix must be either bt601 or bt709; found " << YUV_MATRIX << "." << std::endl;
+            return retCode = 1;
+        }
+        const YuvMatrix YUV_MATRIX_MODE{("bt709" == YUV_MATRIX) ? YuvMatrix::BT709 : YuvMatrix::BT601};
+        const std::string YUV_RANGE{commandlineArguments["yuv.range"]};
+        if ( !YUV_RANGE.empty() && ("limited" != YUV_RANGE) && ("full" != YUV_RANGE) ) {
+            std::cerr << "[opendlv-device-camera-ueye]: yuv.range must be either limited or full; found " << YUV_RANGE << "." << std::endl;
+            return retCode = 1;
+        }
+
+        const uint32_t PYRAMID{(commandlineArguments["pyramid"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["pyramid"])) : 0};
+        if (PYRAMID > 4) {
+            std::cerr << "[opendlv-device-camera-ueye]: pyramid must be at most 4; found " << PYRAMID << "." << std::endl;
+            return retCode = 1;
+        }
+
+        const bool TENSOR{commandlineArguments["tensor"].size() != 0};
+        TensorWriter::Parameters tensorParameters;
+        if (TENSOR) {
+            const std::string SIZE{commandlineArguments["tensor"]};
+            const std::string TYPE{(commandlineArguments["tensor.type"].size() != 0) ? commandlineArguments["tensor.type"] : "uint8"};
+            const std::size_t X{SIZE.find('x')};
+            bool valid{(std::string::npos != X) && ( ("uint8" == TYPE) || ("float16" == TYPE) )};
+            if (valid) {
+                tensorParameters.width = static_cast<uint32_t>(std::stoi(SIZE.substr(0, X)));
+                tensorParameters.height = static_cast<uint32_t>(std::stoi(SIZE.substr(X + 1)));
+                tensorParameters.type = ("float16" == TYPE) ? TensorType::FLOAT16 : TensorType::UINT8;
+                tensorParameters.bgr = (commandlineArguments.count("tensor.bgr") != 0);
+                const int32_t PAD{(commandlineArguments["tensor.pad"].size() != 0) ? std::stoi(commandlineArguments["tensor.pad"]) : 114};
+                tensorParameters.pad = static_cast<uint8_t>(PAD);
+                valid = (0 < tensorParameters.width) && (0 < tensorParameters.height) && (0 <= PAD) && (PAD <= 255);
+            }
+            // Three comma separated values, one per R, G, and B.
+            auto perChannel = [&commandlineArguments](const std::string &name, float *values) {
+                const std::string VALUES{commandlineArguments[name]};
+                if (VALUES.empty()) {
+                    return true;
+                }
+                std::istringstream in{VALUES};
+                std::string value;
+                uint32_t count{0};
+                while ((count < 3) && std::getline(in, value, ',')) {
+                    values[count++] = std::stof(value);
+                }
+                return (3 == count) && in.eof();
+            };
+            valid = valid && perChannel("tensor.mean", tensorParameters.mean) && perChannel("tensor.std", tensorParameters.stddev);
+            for (float stddev : tensorParameters.stddev) {
+                valid = valid && (stddev > 0.0f);
+            }
+            if (!valid) {
+                std::cerr << "[opendlv-device-camera-ueye]: tensor must be <width>x<height>, tensor.type uint8 or float16, tensor.mean and tensor.std three comma separated values with positive tensor.std, and tensor.pad in [0, 255]." << std::endl;
+                return retCode = 1;
+            }
+        }
+
+        const std::string RGB_SIZE{commandlineArguments["rgb"]};
+        const bool RGB{!RGB_SIZE.empty()};
+        uint32_t rgbWidth{0};
+        uint32_t rgbHeight{0};
+        if (RGB) {
+            const std::size_t X{RGB_SIZE.find('x')};
+            if (std::string::npos != X) {
+                rgbWidth = static_cast<uint32_t>(std::stoi(RGB_SIZE.substr(0, X)));
+                rgbHeight = static_cast<uint32_t>(std::stoi(RGB_SIZE.substr(X + 1)));
+            }
+            if ( (0 == rgbWidth) || (0 == rgbHeight) ) {
+                std::cerr << "[opendlv-device-camera-ueye]: rgb must be <width>x<height>; found " << RGB_SIZE << "." << std::endl;
+                return retCode = 1;
+            }
+        }
+
+        const bool TONEMAP{commandlineArguments.count("tonemap") != 0};
+        const float TONEMAP_COMPRESSION{(commandlineArguments["tonemap"].size() != 0) ? std::stof(commandlineArguments["tonemap"]) : 8.0f};
+        const float TONEMAP_EXPOSURE{(commandlineArguments["tonemap.exposure"].size() != 0) ? std::stof(commandlineArguments["tonemap.exposure"]) / 1000.0f : 0.0f};
+        const uint32_t TONEMAP_TILES{(commandlineArguments["tonemap.tiles"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["tonemap.tiles"])) : 0};
+        const float TONEMAP_STRENGTH{(commandlineArguments["tonemap.strength"].size() != 0) ? std::stof(commandlineArguments["tonemap.strength"]) : 0.5f};
+        if ( (TONEMAP_COMPRESSION < 0.0f) || (TONEMAP_EXPOSURE < 0.0f) || (TONEMAP_STRENGTH < 0.0f) || (TONEMAP_STRENGTH > 1.0f) ) {
+            std::cerr << "[opendlv-device-camera-ueye]: tonemap and tonemap.exposure must not be negative and tonemap.strength must be in [0, 1]." << std::endl;
+            return retCode = 1;
+        }
+
+        const std::string ACQUISITION{(commandlineArguments["acquisition"].size() != 0) ? commandlineArguments["acquisition"] : "poll"};
+        if ( ("poll" != ACQUISITION) && ("callback" != ACQUISITION) ) {
+            std::cerr << "[opendlv-device-camera-ueye]: acquisition must be either poll or callback; found " << ACQUISITION << "." << std::endl;
+            return retCode = 1;
+        }
+        const bool CALLBACK_ACQUISITION{"callback" == ACQUISITION};
+
+        const std::string TIMESTAMP{(commandlineArguments["timestamp"].size() != 0) ? commandlineArguments["timestamp"] : "camera"};
+        if ( ("camera" != TIMESTAMP) && ("host" != TIMESTAMP) ) {
+            std::cerr << "[opendlv-device-camera-ueye]: timestamp must be either camera or host; found " << TIMESTAMP << "." << std::endl;
+            return retCode = 1;
+        }
+        const bool CAMERA_TIMESTAMP{"camera" == TIMESTAMP};
+        const bool MID_EXPOSURE{commandlineArguments.count("mid_exposure") != 0};
+
+        const float STATS{(commandlineArguments["stats"].size() != 0) ? static_cast<float>(std::stof(commandlineArguments["stats"])) : 0.0f};
+
         // Set up the names for the shared memory areas.
         std::string NAME_I420{"ueye.i420"};
         if ((commandlineArguments["name.i420"].size() != 0)) {
@@ -68,42 +305,315 @@ int32_t main(int32_t argc, char **argv) {
         if ((commandlineArguments["name.argb"].size() != 0)) {
             NAME_ARGB = commandlineArguments["name.argb"];
         }
+        std::string NAME_TELEMETRY{"ueye.telemetry"};
+        if ((commandlineArguments["name.telemetry"].size() != 0)) {
+            NAME_TELEMETRY = commandlineArguments["name.telemetry"];
+        }
+        const std::string NAME_RAW16{commandlineArguments["name.raw16"]};
+        const bool NV12{commandlineArguments.count("nv12") != 0};
+        std::string NAME_NV12{"ueye.nv12"};
+        if ((commandlineArguments["name.nv12"].size() != 0)) {
+            NAME_NV12 = commandlineArguments["name.nv12"];
+        }
+        const bool GRAY{commandlineArguments.count("gray") != 0};
+        std::string NAME_GRAY{"ueye.gray"};
+        if ((commandlineArguments["name.gray"].size() != 0)) {
+            NAME_GRAY = commandlineArguments["name.gray"];
+        }
+        std::string NAME_RGB{"ueye.rgb"};
+        if ((commandlineArguments["name.rgb"].size() != 0)) {
+            NAME_RGB = commandlineArguments["name.rgb"];
+        }
+        std::string NAME_TENSOR{"ueye.tensor"};
+        if ((commandlineArguments["name.tensor"].size() != 0)) {
+            NAME_TENSOR = commandlineArguments["name.tensor"];
+        }
 
         // Initialize camera.
         PxLCamera pxLCamera(0);
         PXL_RETURN_CODE rc;
+        // Only read out the requested window of the sensor; this reduces bus
+        // bandwidth and conversion work and allows for higher frame rates.
         PXL_ROI roi;
+        roi.m_width = REQUESTED_WIDTH;
+        roi.m_height = REQUESTED_HEIGHT;
+        roi.m_left = LEFT;
+        roi.m_top = TOP;
+        rc = pxLCamera.setRoiValue(roi);
+        if (!API_SUCCESS(rc)) {
+            std::cerr << "[opendlv-device-camera-ueye]: Failed to set region of interest " << REQUESTED_WIDTH << "x" << REQUESTED_HEIGHT;
+            if ( (LEFT >= 0) || (TOP >= 0) ) {
+                std::cerr << " at (" << LEFT << ", " << TOP << ")";
+            }
+            std::cerr << ": " << PxLError(rc).showReason() << std::endl;
+            return retCode = 1;
+        }
+        // The camera may have adjusted the region of interest.
         rc = pxLCamera.getRoiValue(&roi);
         if (!API_SUCCESS(rc)) {
-          std::cerr << "error!";
+            std::cerr << "[opendlv-device-camera-ueye]: Failed to read region of interest: " << PxLError(rc).showReason() << std::endl;
+            return retCode = 1;
         }
-        const uint32_t WIDTH{static_cast<uint32_t>(roi.m_width)};
-        const uint32_t HEIGHT{static_cast<uint32_t>(roi.m_height)};
+        std::clog << "[opendlv-device-camera-ueye]: Region of interest " << roi.m_width << "x" << roi.m_height << " at (" << roi.m_left << ", " << roi.m_top << ")." << std::endl;
 
-        float currentValue;
-        pxLCamera.getValue(FEATURE_PIXEL_FORMAT, &currentValue);
-        std::cout << "Current pixel format: " << currentValue << std::endl; // PIXEL_FORMAT_BAYER8_RGGB      7
+        rc = pxLCamera.setPixelAddressValue(pixelAddressingMode, static_cast<float>(pixelAddressingFactor));
+        if (!API_SUCCESS(rc)) {
+            std::cerr << "[opendlv-device-camera-ueye]: Failed to set pixel addressing by " << pixelAddressingFactor << ": " << PxLError(rc).showReason() << std::endl;
+            return retCode = 1;
+        }
 
-        auto image_size = pxLCamera.getImageSize();
-        std::unique_ptr<uint8_t []> buffer = std::make_unique<uint8_t []>(image_size);
-        // FIXME easy 20180331 - x265 ffmpeg only works at 1920x1080. Need to manually set ROI first.
+        // All buffer and shared memory sizes follow from the resulting frame size.
+        uint32_t frameWidth{0};
+        uint32_t frameHeight{0};
+        rc = pxLCamera.getImageDimensions(&frameWidth, &frameHeight);
+        if (!API_SUCCESS(rc) || (0 == frameWidth) || (0 == frameHeight) || (0 != (frameWidth % 2)) || (0 != (frameHeight % 2))) {
+            std::cerr << "[opendlv-device-camera-ueye]: Frame size " << frameWidth << "x" << frameHeight << " is not supported; width and height after pixel addressing must be even." << std::endl;
+            return retCode = 1;
+        }
+        const uint32_t WIDTH{frameWidth};
+        const uint32_t HEIGHT{frameHeight};
+        std::clog << "[opendlv-device-camera-ueye]: Frames are " << WIDTH << "x" << HEIGHT << "." << std::endl;
 
-        rc = pxLCamera.play();
+        // Grey and YUV 4:2:2 frames are published as they are; for Bayer frames,
+        // the colour filter layout depends on the sensor and on how PxLCamera
+        // flips the image.
+        float pixelFormat{0.0f};
+        bool horizontalFlip{false};
+        bool verticalFlip{false};
+        rc = pxLCamera.getValue(FEATURE_PIXEL_FORMAT, &pixelFormat);
+        if (API_SUCCESS(rc) && pxLCamera.supported(FEATURE_FLIP)) {
+            rc = pxLCamera.getFlip(&horizontalFlip, &verticalFlip);
+        }
+        const bool MONO{PIXEL_FORMAT_MONO8 == static_cast<int>(pixelFormat)};
+        const bool YUV{PIXEL_FORMAT_YUV422 == static_cast<int>(pixelFormat)};
+        const PXL_PIXEL_FORMATS PXL_FORMAT{PxLPixelFormat_fromApi(pixelFormat)};
+        const PXL_BAYER_PATTERNS PXL_PATTERN{PxLBayerPattern_fromApi(pixelFormat, horizontalFlip, verticalFlip)};
+        const bool BAYER{((BAYER8 == PXL_FORMAT) || (BAYER12_PACKED == PXL_FORMAT) || (BAYER16 == PXL_FORMAT)) && (BAYER_PATTERN_NONE != PXL_PATTERN)};
+        if (!API_SUCCESS(rc) || !(MONO || YUV || BAYER)) {
+            std::cerr << "[opendlv-device-camera-ueye]: Pixel format " << pixelFormat << " is not supported; an 8 bit mono, an 8, 12, or 16 bit Bayer format, or YUV422 is required." << std::endl;
+            return retCode = 1;
+        }
+        BayerFormat bayerFormat{BayerFormat::BAYER8};
+        if (BAYER16 == PXL_FORMAT) {
+            bayerFormat = BayerFormat::BAYER16;
+        }
+        else if (BAYER12_PACKED == PXL_FORMAT) {
+            bayerFormat = PxLPixelFormat_isMsFirst(pixelFormat) ? BayerFormat::BAYER12_PACKED_MSFIRST : BayerFormat::BAYER12_PACKED;
+        }
+        const bool RAW16{!NAME_RAW16.empty()};
+        if (RAW16 && !(BAYER && (BayerFormat::BAYER8 != bayerFormat))) {
+            std::cerr << "[opendlv-device-camera-ueye]: name.raw16 requires a 12 or 16 bit Bayer pixel format." << std::endl;
+            return retCode = 1;
+        }
+        if (TONEMAP && !(BAYER && (BayerFormat::BAYER8 != bayerFormat))) {
+            std::cerr << "[opendlv-device-camera-ueye]: tonemap requires a 12 or 16 bit Bayer pixel format." << std::endl;
+            return retCode = 1;
+        }
+        const uint32_t ISP_BLACK{(commandlineArguments["isp.black"].size() != 0) ? static_cast<uint32_t>(std::stoi(commandlineArguments["isp.black"])) : 0};
+        const std::string ISP_DEFECTS{commandlineArguments["isp.defects"]};
+        const std::string ISP_SHADING{commandlineArguments["isp.shading"]};
+        const bool ISP{(0 < ISP_BLACK) || !ISP_DEFECTS.empty() || !ISP_SHADING.empty()};
+        if (ISP && !BAYER) {
+            std::cerr << "[opendlv-device-camera-ueye]: isp.black, isp.defects, and isp.shading require a Bayer pixel format." << std::endl;
+            return retCode = 1;
+        }
+        if (RGB && !(BAYER && (rgbWidth <= WIDTH / 2) && (rgbHeight <= HEIGHT / 2))) {
+            std::cerr << "[opendlv-device-camera-ueye]: rgb requires a Bayer pixel format and must be at most " << WIDTH / 2 << "x" << HEIGHT / 2 << "." << std::endl;
+            return retCode = 1;
+        }
+        if ( (MONO || YUV) && (Demosaic::SUPERPIXEL == DEMOSAIC_MODE) ) {
+            std::cerr << "[opendlv-device-camera-ueye]: superpixel demosaicing requires a Bayer pixel format." << std::endl;
+            return retCode = 1;
+        }
+        if (YUV && ( (YuvMatrix::BT601 != YUV_MATRIX_MODE) || ("full" == YUV_RANGE) )) {
+            std::cerr << "[opendlv-device-camera-ueye]: YUV422 frames are published as BT.601 with limited range as they come from the camera." << std::endl;
+            return retCode = 1;
+        }
+        // Mono frames are published unchanged unless asked otherwise.
+        const YuvRange YUV_RANGE_MODE{(("full" == YUV_RANGE) || (MONO && YUV_RANGE.empty())) ? YuvRange::FULL : YuvRange::LIMITED};
+        if (MONO || YUV) {
+            std::clog << "[opendlv-device-camera-ueye]: Pixel format " << pixelFormat << ": frames are " << (MONO ? "mono" : "YUV422") << "." << std::endl;
+        }
+        else {
+            const char *names[]{"RGGB", "GRBG", "GBRG", "BGGR"};
+            std::clog << "[opendlv-device-camera-ueye]: Pixel format " << pixelFormat << ", flip " << horizontalFlip << "/" << verticalFlip << ": frames are " << PxLFormats[PXL_FORMAT] << " " << names[PXL_PATTERN] << "." << std::endl;
+        }
+
+        // The published images are smaller than the frames in superpixel mode.
+        const uint32_t OUTPUT_WIDTH{BayerConverter::outputSize(WIDTH, DEMOSAIC_MODE)};
+        const uint32_t OUTPUT_HEIGHT{BayerConverter::outputSize(HEIGHT, DEMOSAIC_MODE)};
+        if ( (0 != (OUTPUT_WIDTH % 2)) || (0 != (OUTPUT_HEIGHT % 2)) ) {
+            std::cerr << "[opendlv-device-camera-ueye]: Frame size " << WIDTH << "x" << HEIGHT << " is not supported with " << DEMOSAIC << " demosaicing; width and height must be multiples of 4." << std::endl;
+            return retCode = 1;
+        }
+        if ( (TONEMAP_TILES > ToneMapper::MAX_TILES) || (TONEMAP_TILES > WIDTH / 8) || (TONEMAP_TILES > HEIGHT / 8) ) {
+            std::cerr << "[opendlv-device-camera-ueye]: tonemap.tiles must be at most " << ToneMapper::MAX_TILES << " and at most an eighth of width and height." << std::endl;
+            return retCode = 1;
+        }
+
+        const std::string COLOUR{commandlineArguments["colour"]};
+        ColourCorrection::Parameters colourParameters;
+        if (!COLOUR.empty()) {
+            if (!BAYER) {
+                std::cerr << "[opendlv-device-camera-ueye]: colour requires a Bayer pixel format." << std::endl;
+                return retCode = 1;
+            }
+            if (!colourParameters.load(COLOUR)) {
+                std::cerr << "[opendlv-device-camera-ueye]: Failed to load colour correction from '" << COLOUR << "'." << std::endl;
+                return retCode = 1;
+            }
+            // Gamma and white balance are applied in software only.
+            if (!API_SUCCESS(pxLCamera.setGammaValues(1.0f)) || !API_SUCCESS(pxLCamera.setWhiteBalanceValues(1.0f, 1.0f, 1.0f))) {
+                std::cerr << "[opendlv-device-camera-ueye]: Failed to turn off gamma and white balance on the camera." << std::endl;
+            }
+        }
+
+        // Corrections of Bayer frames, loaded before the camera starts streaming.
+        std::unique_ptr<BayerCorrection> correction;
+        if (ISP) {
+            // The black level is given in the pixel format's bit depth;
+            // 12 bit samples are unpacked to the top of 16 bits.
+            const uint32_t maxValue{(BayerFormat::BAYER8 == bayerFormat) ? 255u : 65535u};
+            const uint32_t black{(BayerFormat::BAYER8 == bayerFormat) || (BayerFormat::BAYER16 == bayerFormat) ? ISP_BLACK : ISP_BLACK << 4};
+            if (black >= maxValue / 2) {
+                std::cerr << "[opendlv-device-camera-ueye]: isp.black must be less than half of the largest sample value." << std::endl;
+                return retCode = 1;
+            }
+            correction.reset(new BayerCorrection{WIDTH, HEIGHT, maxValue, black});
+            if (!ISP_DEFECTS.empty() && !correction->loadDefects(ISP_DEFECTS)) {
+                std::cerr << "[opendlv-device-camera-ueye]: Failed to load defective pixels from '" << ISP_DEFECTS << "'." << std::endl;
+                return retCode = 1;
+            }
+            if (!ISP_SHADING.empty() && !correction->loadShading(ISP_SHADING)) {
+                std::cerr << "[opendlv-device-camera-ueye]: Failed to load lens shading gains from '" << ISP_SHADING << "'." << std::endl;
+                return retCode = 1;
+            }
+        }
+
+        // Let the camera produce the desired frequency if it can; any surplus
+        // is decimated before conversion below.
+        if (pxLCamera.supported(FEATURE_FRAME_RATE)) {
+            float minFrameRate{0.0f};
+            float maxFrameRate{0.0f};
+            rc = pxLCamera.getRange(FEATURE_FRAME_RATE, &minFrameRate, &maxFrameRate);
+            if (API_SUCCESS(rc)) {
+                rc = pxLCamera.setValue(FEATURE_FRAME_RATE, std::min(std::max(FREQ, minFrameRate), maxFrameRate));
+            }
+            float frameRate{0.0f};
+            if (API_SUCCESS(rc) && API_SUCCESS(pxLCamera.getValue(FEATURE_FRAME_RATE, &frameRate))) {
+                std::clog << "[opendlv-device-camera-ueye]: Camera frame rate set to " << frameRate << " fps." << std::endl;
+            }
+            else {
+                std::cerr << "[opendlv-device-camera-ueye]: Failed to set camera frame rate: " << PxLError(rc).showReason() << std::endl;
+            }
+        }
+        else {
+            std::clog << "[opendlv-device-camera-ueye]: Camera does not support setting the frame rate; decimating to " << FREQ << " fps." << std::endl;
+        }
 
+        // One more frame than can be queued is needed for the one being converted.
+        pxLCamera.setFramePoolSize(BUFFERS + 1);
+        rc = pxLCamera.play();
+        if (!API_SUCCESS(rc)) {
+            std::cerr << "[opendlv-device-camera-ueye]: Failed to start the camera stream: " << PxLError(rc).showReason() << std::endl;
+            return retCode = 1;
+        }
+        // Free camera.
+        ScopeGuard stopStream{[&pxLCamera]() {
+            if (pxLCamera.streaming()) {
+                pxLCamera.stop();
+            }
+        }};
 
         // Initialize shared memory.
-        std::unique_ptr<cluon::SharedMemory> sharedMemoryI420(new cluon::SharedMemory{NAME_I420, WIDTH * HEIGHT * 3/2});
+        std::unique_ptr<cluon::SharedMemory> sharedMemoryI420(new cluon::SharedMemory{NAME_I420, OUTPUT_WIDTH * OUTPUT_HEIGHT * 3/2});
         if (!sharedMemoryI420 || !sharedMemoryI420->valid()) {
             std::cerr << "[opendlv-device-camera-ueye]: Failed to create shared memory '" << NAME_I420 << "'." << std::endl;
             return retCode = 1;
         }
 
-        std::unique_ptr<cluon::SharedMemory> sharedMemoryARGB(new cluon::SharedMemory{NAME_ARGB, WIDTH * HEIGHT * 4});
+        std::unique_ptr<cluon::SharedMemory> sharedMemoryARGB(new cluon::SharedMemory{NAME_ARGB, OUTPUT_WIDTH * OUTPUT_HEIGHT * 4});
         if (!sharedMemoryARGB || !sharedMemoryARGB->valid()) {
             std::cerr << "[opendlv-device-camera-ueye]: Failed to create shared memory '" << NAME_ARGB << "'." << std::endl;
             return retCode = 1;
         }
 
+        std::unique_ptr<cluon::SharedMemory> sharedMemoryNV12;
+        if (NV12) {
+            sharedMemoryNV12.reset(new cluon::SharedMemory{NAME_NV12, OUTPUT_WIDTH * OUTPUT_HEIGHT * 3/2});
+            if (!sharedMemoryNV12 || !sharedMemoryNV12->valid()) {
+                std::cerr << "[opendlv-device-camera-ueye]: Failed to create shared memory '" << NAME_NV12 << "'." << std::endl;
+                return retCode = 1;
+            }
+            std::clog << "[opendlv-device-camera-ueye]: Data available in NV12 format in shared memory '" << sharedMemoryNV12->name() << "' (" << sharedMemoryNV12->size() << ")." << std::endl;
+        }
+
+        std::unique_ptr<cluon::SharedMemory> sharedMemoryGray;
+        if (GRAY) {
+            sharedMemoryGray.reset(new cluon::SharedMemory{NAME_GRAY, OUTPUT_WIDTH * OUTPUT_HEIGHT});
+            if (!sharedMemoryGray || !sharedMemoryGray->valid()) {
+                std::cerr << "[opendlv-device-camera-ueye]: Failed to create shared memory '" << NAME_GRAY << "'." << std::endl;
+                return retCode = 1;
+            }
+            std::clog << "[opendlv-device-camera-ueye]: Data available in GRAY8 format in shared memory '" << sharedMemoryGray->name() << "' (" << sharedMemoryGray->size() << ")." << std::endl;
+        }
+
+        // Further I420 images at 1/2, 1/4, ... of the size.
+        std::vector<std::unique_ptr<cluon::SharedMemory>> sharedMemoryPyramid;
+        for (uint32_t level{1}; level <= PYRAMID; level++) {
+            const uint32_t levelWidth{Pyramid::levelWidth(OUTPUT_WIDTH, level)};
+            const uint32_t levelHeight{Pyramid::levelHeight(OUTPUT_HEIGHT, level)};
+            const std::string NAME_LEVEL{NAME_I420 + "." + std::to_string(1u << level)};
+            if ( (0 == levelWidth) || (0 == levelHeight) ) {
+                std::cerr << "[opendlv-device-camera-ueye]: Frame size " << OUTPUT_WIDTH << "x" << OUTPUT_HEIGHT << " is too small for " << PYRAMID << " pyramid levels." << std::endl;
+                return retCode = 1;
+            }
+            sharedMemoryPyramid.emplace_back(new cluon::SharedMemory{NAME_LEVEL, levelWidth * levelHeight * 3/2});
+            if (!sharedMemoryPyramid.back() || !sharedMemoryPyramid.back()->valid()) {
+                std::cerr << "[opendlv-device-camera-ueye]: Failed to create shared memory '" << NAME_LEVEL << "'." << std::endl;
+                return retCode = 1;
+            }
+            std::clog << "[opendlv-device-camera-ueye]: " << levelWidth << "x" << levelHeight << " I420 images available in shared memory '" << sharedMemoryPyramid.back()->name() << "' (" << sharedMemoryPyramid.back()->size() << ")." << std::endl;
+        }
+
+        std::unique_ptr<cluon::SharedMemory> sharedMemoryRGB;
+        if (RGB) {
+            sharedMemoryRGB.reset(new cluon::SharedMemory{NAME_RGB, rgbWidth * rgbHeight * 3});
+            if (!sharedMemoryRGB || !sharedMemoryRGB->valid()) {
+                std::cerr << "[opendlv-device-camera-ueye]: Failed to create shared memory '" << NAME_RGB << "'." << std::endl;
+                return retCode = 1;
+            }
+            std::clog << "[opendlv-device-camera-ueye]: " << rgbWidth << "x" << rgbHeight << " RGB24 images available in shared memory '" << sharedMemoryRGB->name() << "' (" << sharedMemoryRGB->size() << ")." << std::endl;
+        }
+
+        std::unique_ptr<TensorWriter> tensorWriter;
+        std::unique_ptr<cluon::SharedMemory> sharedMemoryTensor;
+        if (TENSOR) {
+            tensorWriter.reset(new TensorWriter{OUTPUT_WIDTH, OUTPUT_HEIGHT, tensorParameters});
+            sharedMemoryTensor.reset(new cluon::SharedMemory{NAME_TENSOR, static_cast<uint32_t>(tensorWriter->size())});
+            if (!sharedMemoryTensor || !sharedMemoryTensor->valid()) {
+                std::cerr << "[opendlv-device-camera-ueye]: Failed to create shared memory '" << NAME_TENSOR << "'." << std::endl;
+                return retCode = 1;
+            }
+            std::clog << "[opendlv-device-camera-ueye]: " << tensorParameters.width << "x" << tensorParameters.height << " input tensors available in shared memory '" << sharedMemoryTensor->name() << "' (" << sharedMemoryTensor->size() << ")." << std::endl;
+        }
+
+        std::unique_ptr<cluon::SharedMemory> sharedMemoryTelemetry(new cluon::SharedMemory{NAME_TELEMETRY, sizeof(Telemetry)});
+        if (!sharedMemoryTelemetry || !sharedMemoryTelemetry->valid()) {
+            std::cerr << "[opendlv-device-camera-ueye]: Failed to create shared memory '" << NAME_TELEMETRY << "'." << std::endl;
+            return retCode = 1;
+        }
+
+        std::unique_ptr<cluon::SharedMemory> sharedMemoryRaw16;
+        if (RAW16) {
+            sharedMemoryRaw16.reset(new cluon::SharedMemory{NAME_RAW16, WIDTH * HEIGHT * 2});
+            if (!sharedMemoryRaw16 || !sharedMemoryRaw16->valid()) {
+                std::cerr << "[opendlv-device-camera-ueye]: Failed to create shared memory '" << NAME_RAW16 << "'." << std::endl;
+                return retCode = 1;
+            }
+            std::clog << "[opendlv-device-camera-ueye]: 16 bit Bayer frames available in shared memory '" << sharedMemoryRaw16->name() << "' (" << sharedMemoryRaw16->size() << ")." << std::endl;
+        }
+
         if ( (sharedMemoryI420 && sharedMemoryI420->valid()) &&
              (sharedMemoryARGB && sharedMemoryARGB->valid()) ) {
             std::clog << "[opendlv-device-camera-ueye]: Data from uEye camera available in I420 format in shared memory '" << sharedMemoryI420->name() << "' (" << sharedMemoryI420->size() << ") and in ARGB format in shared memory '" << sharedMemoryARGB->name() << "' (" << sharedMemoryARGB->size() << ")." << std::endl;
@@ -116,65 +626,346 @@ int32_t main(int32_t argc, char **argv) {
             if (VERBOSE) {
                 display = XOpenDisplay(NULL);
                 visual = DefaultVisual(display, 0);
-                window = XCreateSimpleWindow(display, RootWindow(display, 0), 0, 0, WIDTH, HEIGHT, 1, 0, 0);
+                window = XCreateSimpleWindow(display, RootWindow(display, 0), 0, 0, OUTPUT_WIDTH, OUTPUT_HEIGHT, 1, 0, 0);
                 sharedMemoryARGB->lock();
                 {
-                    ximage = XCreateImage(display, visual, 24, ZPixmap, 0, sharedMemoryARGB->data(), WIDTH, HEIGHT, 32, 0);
+                    ximage = XCreateImage(display, visual, 24, ZPixmap, 0, sharedMemoryARGB->data(), OUTPUT_WIDTH, OUTPUT_HEIGHT, 32, 0);
                 }
                 sharedMemoryARGB->unlock();
                 XMapWindow(display, window);
             }
 
-            cv::Mat cv_frame_bayerbg(roi.m_height, roi.m_width,
-                                     CV_8UC1,
-                                     const_cast<unsigned char *>(buffer.get()));
-            cv::Mat cv_frame_bgr; // (_roi.m_height, _roi.m_width, CV_8UC3);
-            while (!cluon::TerminateHandler::instance().isTerminated.load()) {
-                rc = pxLCamera.getNextFrame(image_size, buffer.get());
-
-                // FIXME: set color convert based on pixelink flip values, if not flipped use CV_BayerBG2BGR.
-                cv::cvtColor(cv_frame_bayerbg, cv_frame_bgr, CV_BayerBG2RGB); //CV_BayerRG2BGRA
-                if (API_SUCCESS(rc)) {
-                    cluon::data::TimeStamp ts{cluon::time::now()};
-                    // Transform data as I420 in sharedMemoryI420.
-                    sharedMemoryI420->lock();
-                    sharedMemoryI420->setTimeStamp(ts);
-                    {
-                        libyuv::RGB24ToI420(reinterpret_cast<uint8_t*>(cv_frame_bgr.data), WIDTH*3,
-                                           reinterpret_cast<uint8_t*>(sharedMemoryI420->data()), WIDTH,
-                                           reinterpret_cast<uint8_t*>(sharedMemoryI420->data()+(WIDTH * HEIGHT)), WIDTH/2,
-                                           reinterpret_cast<uint8_t*>(sharedMemoryI420->data()+(WIDTH * HEIGHT + ((WIDTH * HEIGHT) >> 2))), WIDTH/2,
-                                           WIDTH, HEIGHT);
+            // Frames are read from the camera into pooled buffers and handed over
+            // to the conversion loop; neither side allocates memory per frame.
+            // In polling mode, a dedicated capture thread blocks in acquire();
+            // in callback mode, the SDK's callback thread pushes the frames. Either
+            // way, there is exactly one producer for the ring. The producer
+            // signals every frame it pushes; the conversion loop sleeps
+            // until then.
+            SpscRing<PxLFrame> capturedFrames{BUFFERS};
+            std::mutex capturedMutex;
+            std::condition_variable capturedSignal;
+            FrameCounters counters;
+            FramePacer pacer{FREQ};
+            FrameTime frameTime;
+            auto deliver = [&capturedFrames, &capturedMutex, &capturedSignal, &counters, &pacer, &frameTime](PxLFrame &&frame) {
+                if (!frame.valid()) {
+                    counters.droppedFromPool();
+                    return;
+                }
+                const FRAME_DESC *desc{frame.desc()};
+                counters.captured(desc->uFrameNumber);
+                frame.setCameraTime(frameTime.reconstruct(desc->fFrameTime, desc->uFrameNumber, desc->FrameRate.fValue));
+                if (!pacer.accept(frame.cameraTime())) {
+                    counters.decimated++;
+                }
+                else if (!capturedFrames.push(std::move(frame))) {
+                    counters.queueFull++;
+                }
+                else {
+                    // Notifying under the lock keeps the signal from getting
+                    // lost between the consumer's check and its wait.
+                    std::lock_guard<std::mutex> lock{capturedMutex};
+                    capturedSignal.notify_one();
+                }
+            };
+
+            // Stop delivering frames before the ring and the counters go
+            // away, however the loop below is left.
+            std::atomic<bool> capturing{true};
+            std::thread captureThread;
+            ScopeGuard stopCapturing{[&]() {
+                if (CALLBACK_ACQUISITION) {
+                    pxLCamera.setFrameHandler(PxLCamera::FrameHandler());
+                }
+                capturing.store(false);
+                if (captureThread.joinable()) {
+                    captureThread.join();
+                }
+            }};
+            if (CALLBACK_ACQUISITION) {
+                rc = pxLCamera.setFrameHandler(deliver);
+                if (!API_SUCCESS(rc)) {
+                    std::cerr << "[opendlv-device-camera-ueye]: Failed to register frame callback: " << PxLError(rc).showReason() << std::endl;
+                    return retCode = 1;
+                }
+            }
+            else {
+                captureThread = std::thread([&]() {
+                    while (capturing.load() && !cluon::TerminateHandler::instance().isTerminated.load()) {
+                        PxLFrame frame;
+                        const PXL_RETURN_CODE acquired{pxLCamera.acquire(&frame)};
+                        if (API_SUCCESS(acquired)) {
+                            deliver(std::move(frame));
+                        }
+                        else if (PxLCamera::FramePoolExhausted == acquired) {
+                            counters.droppedFromPool();
+                        }
+                        else {
+                            counters.sdkErrors++;
+                        }
                     }
-                    sharedMemoryI420->unlock();
-
-                    sharedMemoryARGB->lock();
-                    sharedMemoryARGB->setTimeStamp(ts);
-                    {
-                        libyuv::I420ToARGB(reinterpret_cast<uint8_t*>(sharedMemoryI420->data()), WIDTH,
-                                           reinterpret_cast<uint8_t*>(sharedMemoryI420->data()+(WIDTH * HEIGHT)), WIDTH/2,
-                                           reinterpret_cast<uint8_t*>(sharedMemoryI420->data()+(WIDTH * HEIGHT + ((WIDTH * HEIGHT) >> 2))), WIDTH/2,
-                                           reinterpret_cast<uint8_t*>(sharedMemoryARGB->data()), WIDTH * 4, WIDTH, HEIGHT);
-
-                        if (VERBOSE) {
-                            XPutImage(display, window, DefaultGC(display, 0), ximage, 0, 0, 0, 0, WIDTH, HEIGHT);
+                });
+            }
+
+            // Waiting longer than this for a consumer to release a shared memory area counts as stall.
+            const std::chrono::microseconds LOCK_STALL{1000};
+            auto lockTimed = [&counters, LOCK_STALL](cluon::SharedMemory &sharedMemory) {
+                const auto before = std::chrono::steady_clock::now();
+                sharedMemory.lock();
+                if (std::chrono::steady_clock::now() - before > LOCK_STALL) {
+                    counters.lockStalls++;
+                }
+            };
+
+            // Time from handing over a frame by the SDK until it is published.
+            LatencyStats latency;
+            FrameClock frameClock;
+            auto lastStats = std::chrono::system_clock::now();
+
+            // The conversion thread works on one of the stripes itself.
+            WorkerPool conversionWorkers{STRIPES};
+            std::unique_ptr<ToneMapper> toneMapper;
+            if (TONEMAP) {
+                toneMapper.reset(new ToneMapper{TONEMAP_COMPRESSION, TONEMAP_EXPOSURE, TONEMAP_TILES, TONEMAP_STRENGTH, WIDTH, HEIGHT, conversionWorkers});
+            }
+            std::unique_ptr<FrameConverter> converter;
+            if (MONO) {
+                converter.reset(new MonoConverter{WIDTH, HEIGHT, conversionWorkers, YUV_RANGE_MODE});
+            }
+            else if (YUV) {
+                converter.reset(new Yuv422Converter{WIDTH, HEIGHT, conversionWorkers});
+            }
+            else {
+                converter.reset(new BayerConverter{WIDTH, HEIGHT, bayerFormat, static_cast<BayerPattern>(PXL_PATTERN), DEMOSAIC_MODE, conversionWorkers, YUV_MATRIX_MODE, YUV_RANGE_MODE,
+                                                   RAW16 ? reinterpret_cast<uint16_t*>(sharedMemoryRaw16->data()) : nullptr, toneMapper.get(), correction.get()});
+            }
+            std::unique_ptr<BayerDownsampler> downsampler;
+            if (RGB) {
+                downsampler.reset(new BayerDownsampler{WIDTH, HEIGHT, bayerFormat, static_cast<BayerPattern>(PXL_PATTERN), rgbWidth, rgbHeight, conversionWorkers});
+            }
+            // NV12 and GRAY8 are written along with I420.
+            converter->setExtraOutputs(NV12 ? reinterpret_cast<uint8_t*>(sharedMemoryNV12->data()) : nullptr,
+                                       GRAY ? reinterpret_cast<uint8_t*>(sharedMemoryGray->data()) : nullptr);
+            // Each stripe of the I420 image is downscaled into the pyramid
+            // levels right after it is written.
+            std::unique_ptr<Pyramid> pyramid;
+            if (0 < PYRAMID) {
+                std::vector<uint8_t*> levels;
+                for (auto &level : sharedMemoryPyramid) {
+                    levels.push_back(reinterpret_cast<uint8_t*>(level->data()));
+                }
+                pyramid.reset(new Pyramid{OUTPUT_WIDTH, OUTPUT_HEIGHT, reinterpret_cast<uint8_t*>(sharedMemoryI420->data()), levels});
+                const Pyramid *levelWriter{pyramid.get()};
+                converter->addStripeHandler([levelWriter](uint32_t firstRow, uint32_t lastRow) {
+                    levelWriter->downscale(firstRow, lastRow);
+                }, pyramid->rowAlignment());
+            }
+            // Reload the colour correction whenever its file changes and
+            // swap it in between two frames.
+            std::atomic<bool> converting{true};
+            std::thread colourThread;
+            if (!COLOUR.empty()) {
+                BayerConverter *bayerConverter{static_cast<BayerConverter*>(converter.get())};
+                bayerConverter->setColour(std::make_shared<const ColourCorrection>(colourParameters));
+                colourThread = std::thread([&converting, &COLOUR, bayerConverter]() {
+                    // Modification time in nanoseconds and size, so that
+                    // edits within the same second are noticed as well.
+                    const auto modified = [&COLOUR]() {
+                        struct stat status{};
+                        if (0 != ::stat(COLOUR.c_str(), &status)) {
+                            return std::make_tuple(static_cast<int64_t>(0), static_cast<int64_t>(0), static_cast<int64_t>(-1));
+                        }
+                        return std::make_tuple(static_cast<int64_t>(status.st_mtim.tv_sec), static_cast<int64_t>(status.st_mtim.tv_nsec),
+                                               static_cast<int64_t>(status.st_size));
+                    };
+                    auto lastModified = modified();
+                    while (converting.load() && !cluon::TerminateHandler::instance().isTerminated.load()) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                        const auto currentModified = modified();
+                        if (currentModified == lastModified) {
+                            continue;
+                        }
+                        lastModified = currentModified;
+                        ColourCorrection::Parameters parameters;
+                        if (parameters.load(COLOUR)) {
+                            bayerConverter->setColour(std::make_shared<const ColourCorrection>(parameters));
+                            std::clog << "[opendlv-device-camera-ueye]: Reloaded colour correction from '" << COLOUR << "'." << std::endl;
+                        }
+                        else {
+                            std::cerr << "[opendlv-device-camera-ueye]: Failed to reload colour correction from '" << COLOUR << "'; keeping the previous one." << std::endl;
                         }
                     }
-                    sharedMemoryARGB->unlock();
+                });
+            }
+
+            while (!cluon::TerminateHandler::instance().isTerminated.load()) {
+                PxLFrame frame;
+                if (!capturedFrames.pop(frame)) {
+                    // The termination signal cannot notify; wake up now and
+                    // then to check for it.
+                    std::unique_lock<std::mutex> lock{capturedMutex};
+                    capturedSignal.wait_for(lock, std::chrono::milliseconds(100), [&capturedFrames]() {
+                        return !capturedFrames.empty();
+                    });
+                    continue;
+                }
+                const auto arrival = frame.arrival();
+                const auto conversionStart = std::chrono::steady_clock::now();
+
+                // FRAME_DESC::fFrameTime is taken at the start of the exposure.
+                const FRAME_DESC *desc{frame.desc()};
+                Telemetry telemetry;
+                telemetry.version = Telemetry::VERSION;
+                telemetry.frameNumber = desc->uFrameNumber;
+                telemetry.cameraTimeUs = static_cast<int64_t>(std::llround(frame.cameraTime() * 1000.0 * 1000.0));
+                telemetry.timestampUs = frameClock.map(frame.cameraTime(), desc->uFrameNumber, cluon::time::toMicroseconds(cluon::time::convert(arrival)));
+                telemetry.clockOffsetUs = frameClock.offsetUs();
+                telemetry.clockSkew = frameClock.skew();
+                telemetry.yuvMatrix = static_cast<uint32_t>(converter->yuvMatrix());
+                telemetry.yuvRange = static_cast<uint32_t>(converter->yuvRange());
+                const float framePeriod{(desc->FrameRate.fValue > 0.0f) ? 1.0f / desc->FrameRate.fValue : 0.0f};
+                if (MID_EXPOSURE) {
+                    telemetry.timestampUs += static_cast<int64_t>(desc->Shutter.fValue * 1000.0f * 1000.0f / 2.0f);
+                }
+
+                cluon::data::TimeStamp ts{cluon::time::fromMicroseconds(telemetry.timestampUs)};
 
-                    sharedMemoryI420->notifyAll();
-                    sharedMemoryARGB->notifyAll();
+                if (!CAMERA_TIMESTAMP) {
+                    ts = cluon::time::now();
+                    telemetry.timestampUs = cluon::time::toMicroseconds(ts);
+                }
+                // Transform data as I420 and ARGB straight into sharedMemoryI420
+                // and sharedMemoryARGB in one sweep.
+                lockTimed(*sharedMemoryI420);
+                lockTimed(*sharedMemoryARGB);
+                sharedMemoryI420->setTimeStamp(ts);
+                sharedMemoryARGB->setTimeStamp(ts);
+                if (RAW16) {
+                    lockTimed(*sharedMemoryRaw16);
+                    sharedMemoryRaw16->setTimeStamp(ts);
+                }
+                for (auto &level : sharedMemoryPyramid) {
+                    lockTimed(*level);
+                    level->setTimeStamp(ts);
+                }
+                if (NV12) {
+                    lockTimed(*sharedMemoryNV12);
+                    sharedMemoryNV12->setTimeStamp(ts);
+                }
+                if (GRAY) {
+                    lockTimed(*sharedMemoryGray);
+                    sharedMemoryGray->setTimeStamp(ts);
+                }
+                if (toneMapper) {
+                    toneMapper->update(desc->Shutter.fValue);
+                }
+                {
+                    converter->convert(frame.data(),
+                                       reinterpret_cast<uint8_t*>(sharedMemoryI420->data()),
+                                       reinterpret_cast<uint8_t*>(sharedMemoryI420->data()+(OUTPUT_WIDTH * OUTPUT_HEIGHT)),
+                                       reinterpret_cast<uint8_t*>(sharedMemoryI420->data()+(OUTPUT_WIDTH * OUTPUT_HEIGHT + ((OUTPUT_WIDTH * OUTPUT_HEIGHT) >> 2))),
+                                       reinterpret_cast<uint8_t*>(sharedMemoryARGB->data()));
+                }
+                // The tensor is made from the ARGB image just written.
+                if (TENSOR) {
+                    lockTimed(*sharedMemoryTensor);
+                    sharedMemoryTensor->setTimeStamp(ts);
+                    tensorWriter->write(reinterpret_cast<uint8_t*>(sharedMemoryARGB->data()), reinterpret_cast<uint8_t*>(sharedMemoryTensor->data()), conversionWorkers);
+                    sharedMemoryTensor->unlock();
+                }
+                if (RGB) {
+                    lockTimed(*sharedMemoryRGB);
+                    sharedMemoryRGB->setTimeStamp(ts);
+                    downsampler->downsample(frame.data(), reinterpret_cast<uint8_t*>(sharedMemoryRGB->data()));
+                    sharedMemoryRGB->unlock();
                 }
+                if (RAW16) {
+                    sharedMemoryRaw16->unlock();
+                }
+                for (auto &level : sharedMemoryPyramid) {
+                    level->unlock();
+                }
+                if (NV12) {
+                    sharedMemoryNV12->unlock();
+                }
+                if (GRAY) {
+                    sharedMemoryGray->unlock();
+                }
+                sharedMemoryI420->unlock();
+                frame.release();
+
+                if (VERBOSE) {
+                    XPutImage(display, window, DefaultGC(display, 0), ximage, 0, 0, 0, 0, OUTPUT_WIDTH, OUTPUT_HEIGHT);
+                }
+                sharedMemoryARGB->unlock();
+
+                if ( (framePeriod > 0.0f) && (std::chrono::duration<float>(std::chrono::steady_clock::now() - conversionStart).count() > framePeriod) ) {
+                    counters.conversionOverruns++;
+                }
+                counters.published++;
+                telemetry.published = counters.published.load();
+                telemetry.cameraGaps = counters.cameraGaps.load();
+                telemetry.sdkErrors = counters.sdkErrors.load();
+                telemetry.poolExhausted = counters.poolExhausted.load();
+                telemetry.queueFull = counters.queueFull.load();
+                telemetry.lockStalls = counters.lockStalls.load();
+                telemetry.conversionOverruns = counters.conversionOverruns.load();
+                telemetry.decimated = counters.decimated.load();
+
+                lockTimed(*sharedMemoryTelemetry);
+                sharedMemoryTelemetry->setTimeStamp(ts);
+                {
+                    std::memcpy(sharedMemoryTelemetry->data(), &telemetry, sizeof(Telemetry));
+                }
+                sharedMemoryTelemetry->unlock();
+
+                sharedMemoryI420->notifyAll();
+                sharedMemoryARGB->notifyAll();
+                sharedMemoryTelemetry->notifyAll();
+                if (RAW16) {
+                    sharedMemoryRaw16->notifyAll();
+                }
+                for (auto &level : sharedMemoryPyramid) {
+                    level->notifyAll();
+                }
+                if (NV12) {
+                    sharedMemoryNV12->notifyAll();
+                }
+                if (GRAY) {
+                    sharedMemoryGray->notifyAll();
+                }
+                if (TENSOR) {
+                    sharedMemoryTensor->notifyAll();
+                }
+                if (RGB) {
+                    sharedMemoryRGB->notifyAll();
+                }
+
+                const auto published = std::chrono::system_clock::now();
+                latency.add(std::chrono::duration_cast<std::chrono::microseconds>(published - arrival).count());
+                if ( (STATS > 0) && (std::chrono::duration<float>(published - lastStats).count() >= STATS) ) {
+                    std::clog << "[opendlv-device-camera-ueye]: acquisition=" << ACQUISITION << ", frames=" << latency.count()
+                              << ", latency (us) min/mean/max=" << latency.min() << "/" << latency.mean() << "/" << latency.max()
+                              << ", clock offset (us)=" << frameClock.offsetUs() << ", clock skew (ppm)=" << frameClock.skew() * 1000.0 * 1000.0
+                              << ", published=" << telemetry.published << ", camera gaps=" << telemetry.cameraGaps << ", SDK errors=" << telemetry.sdkErrors
+                              << ", pool exhausted=" << telemetry.poolExhausted << ", queue full=" << telemetry.queueFull
+                              << ", lock stalls=" << telemetry.lockStalls << ", conversion overruns=" << telemetry.conversionOverruns
+                              << ", decimated=" << telemetry.decimated << std::endl;
+                    latency.reset();
+                    lastStats = published;
+                }
+            }
+
+            converting.store(false);
+            if (colourThread.joinable()) {
+                colourThread.join();
             }
 
             if (VERBOSE) {
                 XCloseDisplay(display);
             }
         }
-
-        // Free camera.
-        if (pxLCamera.streaming())
-          pxLCamera.stop();
     }
     return retCode;
 }
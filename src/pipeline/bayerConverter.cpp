@@ -0,0 +1,649 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline/bayerConverter.h"
+#include "pipeline/vectorize.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+
+struct BayerConverter::Job {
+    // 8 bit samples or unpacked 16 bit samples.
+    const uint8_t *frame;
+    uint32_t width;
+    uint32_t height;
+    // Applied to every row before demosaicing, or nullptr.
+    const BayerCorrection *correction;
+    // Applied to the demosaiced colours instead of just narrowing them, or
+    // nullptr.
+    const ColourCorrection *colour;
+    // In the output colour space.
+    I420Rows i420Rows;
+    uint8_t *y;
+    uint8_t *u;
+    uint8_t *v;
+    // Optional.
+    uint8_t *argb;
+    // NV12 Y plane and U and V interleaved.
+    uint8_t *nv12;
+    uint8_t *uv;
+    uint8_t *gray;
+};
+
+namespace {
+
+/**
+ * Demosaics one Bayer row of 8 or 16 bit samples. A row holds green and
+ * one other colour c (red or blue) in alternating columns; the rows above
+ * and below hold green and the remaining colour o. GREEN_FIRST tells
+ * whether even columns are green. All three neighbour rows must be valid;
+ * columns are mirrored at the left and right border.
+ */
+template <typename T, bool GREEN_FIRST>
+inline void demosaicRow(const T *__restrict above, const T *__restrict row, const T *__restrict below, uint32_t width,
+                        T *__restrict c, T *__restrict g, T *__restrict o) noexcept {
+    // Green site: c left and right, o above and below.
+    auto green = [=](uint32_t x, uint32_t left, uint32_t right) {
+        g[x] = row[x];
+        c[x] = static_cast<T>((row[left] + row[right] + 1) >> 1);
+        o[x] = static_cast<T>((above[x] + below[x] + 1) >> 1);
+    };
+    // Colour site: green in the four neighbours, o in the four corners.
+    auto colour = [=](uint32_t x, uint32_t left, uint32_t right) {
+        c[x] = row[x];
+        g[x] = static_cast<T>((row[left] + row[right] + above[x] + below[x] + 2) >> 2);
+        o[x] = static_cast<T>((above[left] + above[right] + below[left] + below[right] + 2) >> 2);
+    };
+
+    // Borders: column -1 is mirrored to 1, column width to width-2.
+    if (GREEN_FIRST) {
+        green(0, 1, 1);
+        colour(width - 1, width - 2, width - 2);
+    }
+    else {
+        colour(0, 1, 1);
+        green(width - 1, width - 2, width - 2);
+    }
+
+    // Interior: one colour and one green site (or vice versa) per iteration,
+    // starting at column 1, written out so that the compiler can vectorize it.
+    const std::size_t pairs{width / 2 - 1};
+    for (std::size_t i{0}; i < pairs; i++) {
+        const std::size_t x{2 * i + 1};
+        const std::size_t l{2 * i};
+        const std::size_t r{2 * i + 2};
+        if (GREEN_FIRST) {
+            c[x]     = row[x];
+            g[x]     = static_cast<T>((row[l] + row[r] + above[x] + below[x] + 2) >> 2);
+            o[x]     = static_cast<T>((above[l] + above[r] + below[l] + below[r] + 2) >> 2);
+            g[x + 1] = row[x + 1];
+            c[x + 1] = static_cast<T>((row[x] + row[x + 2] + 1) >> 1);
+            o[x + 1] = static_cast<T>((above[x + 1] + below[x + 1] + 1) >> 1);
+        }
+        else {
+            g[x]     = row[x];
+            c[x]     = static_cast<T>((row[l] + row[r] + 1) >> 1);
+            o[x]     = static_cast<T>((above[x] + below[x] + 1) >> 1);
+            c[x + 1] = row[x + 1];
+            g[x + 1] = static_cast<T>((row[x] + row[x + 2] + above[x + 1] + below[x + 1] + 2) >> 2);
+            o[x + 1] = static_cast<T>((above[x] + above[x + 2] + below[x] + below[x + 2] + 2) >> 2);
+        }
+    }
+}
+
+/**
+ * Turns the two Bayer rows of a row of 2x2 cells into one row of RGB at
+ * half the width: red and blue are taken as they are and the two greens are
+ * averaged.
+ */
+template <typename T, bool RED_ROW_ODD, bool RED_COLUMN_ODD>
+inline void superpixelRow(const T *__restrict row0, const T *__restrict row1, uint32_t outputWidth,
+                          T *__restrict r, T *__restrict g, T *__restrict b) noexcept {
+    const T *__restrict redRow{RED_ROW_ODD ? row1 : row0};
+    const T *__restrict blueRow{RED_ROW_ODD ? row0 : row1};
+    const std::size_t redColumn{RED_COLUMN_ODD ? 1u : 0u};
+    const std::size_t blueColumn{1u - redColumn};
+    for (std::size_t x{0}; x < outputWidth; x++) {
+        r[x] = redRow[2 * x + redColumn];
+        g[x] = static_cast<T>((redRow[2 * x + blueColumn] + blueRow[2 * x + redColumn] + 1) >> 1);
+        b[x] = blueRow[2 * x + blueColumn];
+    }
+}
+
+/**
+ * Reduces a row of 16 bit samples to their 8 most significant bits; 8 bit
+ * rows are used as they are.
+ */
+inline const uint8_t *narrowRow(const uint8_t *row, uint32_t, uint8_t *) noexcept {
+    return row;
+}
+
+inline const uint8_t *narrowRow(const uint16_t *__restrict row, uint32_t width, uint8_t *__restrict narrow) noexcept {
+    for (std::size_t x{0}; x < width; x++) {
+        narrow[x] = static_cast<uint8_t>(row[x] >> 8);
+    }
+    return narrow;
+}
+
+inline uint8_t clampToByte(int32_t value) noexcept {
+    return static_cast<uint8_t>(std::min(std::max(value, 0), 255));
+}
+
+/**
+ * Turns two rows of RGB into one row of U and V with the coefficients of
+ * YuvCoefficients<MATRIX, RANGE>, computed from the sum of each 2x2 block,
+ * and, if NV12, also into one row of U and V interleaved. Only full range
+ * chroma can leave [0, 255] by rounding.
+ */
+template <YuvMatrix MATRIX, YuvRange RANGE, bool NV12>
+inline void rgbToChromaRow(const uint8_t *__restrict r0, const uint8_t *__restrict g0, const uint8_t *__restrict b0,
+                           const uint8_t *__restrict r1, const uint8_t *__restrict g1, const uint8_t *__restrict b1, uint32_t width,
+                           uint8_t *__restrict u, uint8_t *__restrict v, uint8_t *__restrict uv) noexcept {
+    typedef YuvCoefficients<MATRIX, RANGE> C;
+    const int32_t ur{C::UR}, ug{C::UG}, ub{C::UB};
+    const int32_t vr{C::VR}, vg{C::VG}, vb{C::VB};
+    // Four samples per block, hence two more fractional bits.
+    const int32_t cOffset{(128 << (YUV_BITS + 2)) + (1 << (YUV_BITS + 1))};
+    for (std::size_t x{0}; x < width / 2; x++) {
+        const int32_t r{r0[2 * x] + r0[2 * x + 1] + r1[2 * x] + r1[2 * x + 1]};
+        const int32_t g{g0[2 * x] + g0[2 * x + 1] + g1[2 * x] + g1[2 * x + 1]};
+        const int32_t b{b0[2 * x] + b0[2 * x + 1] + b1[2 * x] + b1[2 * x + 1]};
+        u[x] = clampToByte((ur * r + ug * g + ub * b + cOffset) >> (YUV_BITS + 2));
+        v[x] = clampToByte((vr * r + vg * g + vb * b + cOffset) >> (YUV_BITS + 2));
+        if (NV12) {
+            uv[2 * x]     = u[x];
+            uv[2 * x + 1] = v[x];
+        }
+    }
+}
+
+/**
+ * Turns two rows of RGB into two rows of Y and one row of U and V with the
+ * coefficients of YuvCoefficients<MATRIX, RANGE>, and U and V also into a
+ * row of NV12 chroma unless uv is nullptr.
+ */
+template <YuvMatrix MATRIX, YuvRange RANGE>
+inline void rgbToI420Rows(const uint8_t *__restrict r0, const uint8_t *__restrict g0, const uint8_t *__restrict b0,
+                          const uint8_t *__restrict r1, const uint8_t *__restrict g1, const uint8_t *__restrict b1, uint32_t width,
+                          uint8_t *__restrict y0, uint8_t *__restrict y1, uint8_t *__restrict u, uint8_t *__restrict v, uint8_t *__restrict uv) noexcept {
+    typedef YuvCoefficients<MATRIX, RANGE> C;
+    const int32_t yr{C::YR}, yg{C::YG}, yb{C::YB};
+    const int32_t yOffset{(C::Y_OFFSET << YUV_BITS) + (1 << (YUV_BITS - 1))};
+    for (std::size_t x{0}; x < width; x++) {
+        y0[x] = clampToByte((yr * r0[x] + yg * g0[x] + yb * b0[x] + yOffset) >> YUV_BITS);
+        y1[x] = clampToByte((yr * r1[x] + yg * g1[x] + yb * b1[x] + yOffset) >> YUV_BITS);
+    }
+    if (nullptr == uv) {
+        rgbToChromaRow<MATRIX, RANGE, false>(r0, g0, b0, r1, g1, b1, width, u, v, uv);
+    }
+    else {
+        rgbToChromaRow<MATRIX, RANGE, true>(r0, g0, b0, r1, g1, b1, width, u, v, uv);
+    }
+}
+
+// One entry point per colour space; a kernel calls the one of its frame for
+// every pair of rows while they are still in cache.
+#define I420_ROWS(NAME, MATRIX, RANGE)                                                                                               \
+    PIPELINE_SIMD_CLONES                                                                                                             \
+    void NAME(const uint8_t *r0, const uint8_t *g0, const uint8_t *b0, const uint8_t *r1, const uint8_t *g1, const uint8_t *b1,     \
+              uint32_t width, uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v, uint8_t *uv) noexcept {                              \
+        rgbToI420Rows<MATRIX, RANGE>(r0, g0, b0, r1, g1, b1, width, y0, y1, u, v, uv);                                               \
+    }
+
+I420_ROWS(bt601LimitedRows, YuvMatrix::BT601, YuvRange::LIMITED)
+I420_ROWS(bt601FullRows, YuvMatrix::BT601, YuvRange::FULL)
+I420_ROWS(bt709LimitedRows, YuvMatrix::BT709, YuvRange::LIMITED)
+I420_ROWS(bt709FullRows, YuvMatrix::BT709, YuvRange::FULL)
+
+#undef I420_ROWS
+
+/**
+ * Writes one row of RGB as ARGB, that is B, G, R, and A in memory order
+ * (one little-endian 32 bit word per pixel, like libyuv).
+ */
+inline void rgbToARGBRow(const uint8_t *__restrict r, const uint8_t *__restrict g, const uint8_t *__restrict b, uint32_t width,
+                         uint32_t *__restrict argb) noexcept {
+    for (std::size_t x{0}; x < width; x++) {
+        argb[x] = 0xFF000000u | (static_cast<uint32_t>(r[x]) << 16) | (static_cast<uint32_t>(g[x]) << 8) | b[x];
+    }
+}
+
+/**
+ * Reduces a sample to ColourCorrection::LUT_BITS bits.
+ */
+inline int32_t tableSample(uint8_t v) noexcept {
+    return (static_cast<int32_t>(v) * 257) >> 4;
+}
+
+inline int32_t tableSample(uint16_t v) noexcept {
+    return static_cast<int32_t>(v) >> 4;
+}
+
+/**
+ * Applies the colour correction matrix to a row of RGB and maps the result
+ * through the gamma table into 8 bit rows. The matrix products go into the
+ * index rows first so that the table lookups, which do not vectorize, run
+ * in a loop of their own.
+ */
+template <typename T>
+inline void colourRow(const T *__restrict r, const T *__restrict g, const T *__restrict b, uint32_t width, const ColourCorrection &colour,
+                      uint16_t *__restrict ri, uint16_t *__restrict gi, uint16_t *__restrict bi,
+                      uint8_t *__restrict ro, uint8_t *__restrict go, uint8_t *__restrict bo) noexcept {
+    const int32_t *m{colour.matrix()};
+    const int32_t m0{m[0]}, m1{m[1]}, m2{m[2]}, m3{m[3]}, m4{m[4]}, m5{m[5]}, m6{m[6]}, m7{m[7]}, m8{m[8]};
+    const int32_t round{1 << (ColourCorrection::MATRIX_BITS - 1)};
+    const int32_t last{(1 << ColourCorrection::LUT_BITS) - 1};
+    for (std::size_t x{0}; x < width; x++) {
+        const int32_t rv{tableSample(r[x])};
+        const int32_t gv{tableSample(g[x])};
+        const int32_t bv{tableSample(b[x])};
+        ri[x] = static_cast<uint16_t>(std::min(std::max((m0 * rv + m1 * gv + m2 * bv + round) >> ColourCorrection::MATRIX_BITS, 0), last));
+        gi[x] = static_cast<uint16_t>(std::min(std::max((m3 * rv + m4 * gv + m5 * bv + round) >> ColourCorrection::MATRIX_BITS, 0), last));
+        bi[x] = static_cast<uint16_t>(std::min(std::max((m6 * rv + m7 * gv + m8 * bv + round) >> ColourCorrection::MATRIX_BITS, 0), last));
+    }
+    const uint8_t *__restrict lut{colour.lut()};
+    for (std::size_t x{0}; x < width; x++) {
+        ro[x] = lut[ri[x]];
+        go[x] = lut[gi[x]];
+        bo[x] = lut[bi[x]];
+    }
+}
+
+/**
+ * Row buffers of one stripe: R, G, and B of two output rows as T, the same
+ * reduced to 8 bit, and room for one row each of R, G, and B as table
+ * indices for colour correction.
+ */
+template <typename T>
+struct StripeRows {
+    StripeRows(uint8_t *scratch, uint32_t width) noexcept
+        : wide{reinterpret_cast<T *>(scratch + 6 * width)}
+        , narrow{scratch}
+        , indices{reinterpret_cast<uint16_t *>(scratch + (6 + 6 * sizeof(T)) * width)} {}
+
+    // Bytes needed for a row width.
+    static uint32_t size(uint32_t width) noexcept {
+        return (6 + 6 * sizeof(T) + 3 * sizeof(uint16_t)) * width;
+    }
+
+    T *wideRow(uint32_t i, uint32_t width) const noexcept {
+        return wide + i * width;
+    }
+    uint8_t *narrowRow(uint32_t i, uint32_t width) const noexcept {
+        return narrow + i * width;
+    }
+    uint16_t *indexRow(uint32_t i, uint32_t width) const noexcept {
+        return indices + i * width;
+    }
+
+    T *wide;
+    uint8_t *narrow;
+    uint16_t *indices;
+};
+
+/**
+ * The Bayer rows a stripe reads: straight from the frame, or corrected
+ * into a ring of four rows, which holds all rows a pair of output rows
+ * needs. Rows are corrected when first asked for, so rows shared by
+ * neighbouring output rows are corrected only once.
+ */
+template <typename T>
+class SourceRows {
+   public:
+    // Bytes needed for rows of the given width.
+    static uint32_t size(uint32_t width) noexcept {
+        return (4 * sizeof(T) + sizeof(uint16_t)) * width;
+    }
+
+    SourceRows(const BayerConverter::Job &job, uint8_t *scratch) noexcept
+        : m_frame{reinterpret_cast<const T *>(job.frame)}
+        , m_width{job.width}
+        , m_correction{job.correction}
+        , m_ring{reinterpret_cast<T *>(scratch)}
+        , m_gains{reinterpret_cast<uint16_t *>(scratch + 4 * sizeof(T) * job.width)} {}
+
+    const T *row(uint32_t y) noexcept {
+        const T *frameRow{m_frame + static_cast<std::size_t>(y) * m_width};
+        if (nullptr == m_correction) {
+            return frameRow;
+        }
+        T *slot{m_ring + (y & 3) * m_width};
+        if (m_rows[y & 3] != y) {
+            m_correction->correct(frameRow, y, slot, m_gains);
+            m_rows[y & 3] = y;
+        }
+        return slot;
+    }
+
+   private:
+    const T *m_frame;
+    const uint32_t m_width;
+    const BayerCorrection *m_correction;
+    T *m_ring;
+    uint16_t *m_gains;
+    uint32_t m_rows[4]{UINT32_MAX, UINT32_MAX, UINT32_MAX, UINT32_MAX};
+};
+
+/**
+ * Turns the two demosaiced rows into two rows of Y, one row each of U and V,
+ * and two rows of ARGB at output row y.
+ */
+template <typename T>
+inline void emitRows(const BayerConverter::Job &job, const StripeRows<T> &rows, uint32_t width, uint32_t y) noexcept {
+    const uint8_t *r0{rows.narrowRow(0, width)};
+    const uint8_t *g0{rows.narrowRow(1, width)};
+    const uint8_t *b0{rows.narrowRow(2, width)};
+    const uint8_t *r1{rows.narrowRow(3, width)};
+    const uint8_t *g1{rows.narrowRow(4, width)};
+    const uint8_t *b1{rows.narrowRow(5, width)};
+    if (nullptr != job.colour) {
+        for (uint32_t i{0}; i < 6; i += 3) {
+            colourRow(rows.wideRow(i, width), rows.wideRow(i + 1, width), rows.wideRow(i + 2, width), width, *job.colour,
+                      rows.indexRow(0, width), rows.indexRow(1, width), rows.indexRow(2, width),
+                      rows.narrowRow(i, width), rows.narrowRow(i + 1, width), rows.narrowRow(i + 2, width));
+        }
+    }
+    else {
+        r0 = narrowRow(rows.wideRow(0, width), width, rows.narrowRow(0, width));
+        g0 = narrowRow(rows.wideRow(1, width), width, rows.narrowRow(1, width));
+        b0 = narrowRow(rows.wideRow(2, width), width, rows.narrowRow(2, width));
+        r1 = narrowRow(rows.wideRow(3, width), width, rows.narrowRow(3, width));
+        g1 = narrowRow(rows.wideRow(4, width), width, rows.narrowRow(4, width));
+        b1 = narrowRow(rows.wideRow(5, width), width, rows.narrowRow(5, width));
+    }
+    uint8_t *y0{job.y + y * width};
+    job.i420Rows(r0, g0, b0, r1, g1, b1, width, y0, y0 + width,
+                 job.u + (y / 2) * (width / 2), job.v + (y / 2) * (width / 2),
+                 (nullptr != job.uv) ? job.uv + (y / 2) * width : nullptr);
+    // The two rows of Y are still in L1 cache.
+    if (nullptr != job.nv12) {
+        std::memcpy(job.nv12 + y * width, y0, 2 * width);
+    }
+    if (nullptr != job.gray) {
+        std::memcpy(job.gray + y * width, y0, 2 * width);
+    }
+    if (nullptr != job.argb) {
+        rgbToARGBRow(r0, g0, b0, width, reinterpret_cast<uint32_t *>(job.argb) + y * width);
+        rgbToARGBRow(r1, g1, b1, width, reinterpret_cast<uint32_t *>(job.argb) + (y + 1) * width);
+    }
+}
+
+/**
+ * Converts the output rows [firstRow, lastRow) of a frame with one output
+ * pixel per 2x2 Bayer cell; see superpixelRow.
+ */
+template <typename T, bool RED_ROW_ODD, bool RED_COLUMN_ODD>
+inline void superpixelConvert(const BayerConverter::Job &job, uint32_t firstRow, uint32_t lastRow, uint8_t *scratch) noexcept {
+    const uint32_t outputWidth{job.width / 2};
+    const StripeRows<T> rows{scratch, outputWidth};
+    SourceRows<T> source{job, scratch + StripeRows<T>::size(outputWidth)};
+    for (uint32_t y{firstRow}; y < lastRow; y += 2) {
+        superpixelRow<T, RED_ROW_ODD, RED_COLUMN_ODD>(source.row(2 * y), source.row(2 * y + 1), outputWidth,
+                                                      rows.wideRow(0, outputWidth), rows.wideRow(1, outputWidth), rows.wideRow(2, outputWidth));
+        superpixelRow<T, RED_ROW_ODD, RED_COLUMN_ODD>(source.row(2 * y + 2), source.row(2 * y + 3), outputWidth,
+                                                      rows.wideRow(3, outputWidth), rows.wideRow(4, outputWidth), rows.wideRow(5, outputWidth));
+        emitRows(job, rows, outputWidth, y);
+    }
+}
+
+/**
+ * Converts the rows [firstRow, lastRow) of a Bayer frame. Red sits in odd
+ * rows if RED_ROW_ODD and in odd columns if RED_COLUMN_ODD; rows holding
+ * red also hold green, the others hold green and blue.
+ */
+template <typename T, bool RED_ROW_ODD, bool RED_COLUMN_ODD>
+inline void bayerConvert(const BayerConverter::Job &job, uint32_t firstRow, uint32_t lastRow, uint8_t *scratch) noexcept {
+    const uint32_t width{job.width};
+    const uint32_t height{job.height};
+    const StripeRows<T> rows{scratch, width};
+    SourceRows<T> source{job, scratch + StripeRows<T>::size(width)};
+    T *r0{rows.wideRow(0, width)};
+    T *g0{rows.wideRow(1, width)};
+    T *b0{rows.wideRow(2, width)};
+    T *r1{rows.wideRow(3, width)};
+    T *g1{rows.wideRow(4, width)};
+    T *b1{rows.wideRow(5, width)};
+    for (uint32_t y{firstRow}; y < lastRow; y += 2) {
+        // Row -1 is mirrored to 1 and row height to height-2.
+        const T *above{source.row(0 == y ? 1 : y - 1)};
+        const T *row0{source.row(y)};
+        const T *row1{source.row(y + 1)};
+        const T *below{source.row(y + 2 == height ? y : y + 2)};
+
+        // Green comes first in the red row if red is in odd columns and in
+        // the blue row if blue is.
+        if (RED_ROW_ODD) {
+            demosaicRow<T, !RED_COLUMN_ODD>(above, row0, row1, width, b0, g0, r0);
+            demosaicRow<T, RED_COLUMN_ODD>(row0, row1, below, width, r1, g1, b1);
+        }
+        else {
+            demosaicRow<T, RED_COLUMN_ODD>(above, row0, row1, width, r0, g0, b0);
+            demosaicRow<T, !RED_COLUMN_ODD>(row0, row1, below, width, b1, g1, r1);
+        }
+        emitRows(job, rows, width, y);
+    }
+}
+
+// One entry point per sample size, demosaic method, and pattern, so that the
+// choice is made once per frame and every kernel is compiled for each target
+// of PIPELINE_SIMD_CLONES.
+#define BAYER_KERNEL(NAME, CONVERT, T, RED_ROW_ODD, RED_COLUMN_ODD)                                                                  \
+    PIPELINE_SIMD_CLONES                                                                                                             \
+    void NAME(const BayerConverter::Job &job, uint32_t firstRow, uint32_t lastRow, uint8_t *scratch) noexcept {                      \
+        CONVERT<T, RED_ROW_ODD, RED_COLUMN_ODD>(job, firstRow, lastRow, scratch);                                                    \
+    }
+
+BAYER_KERNEL(bayer8RGGBConvert, bayerConvert, uint8_t, false, false)
+BAYER_KERNEL(bayer8GRBGConvert, bayerConvert, uint8_t, false, true)
+BAYER_KERNEL(bayer8GBRGConvert, bayerConvert, uint8_t, true, false)
+BAYER_KERNEL(bayer8BGGRConvert, bayerConvert, uint8_t, true, true)
+BAYER_KERNEL(superpixel8RGGBConvert, superpixelConvert, uint8_t, false, false)
+BAYER_KERNEL(superpixel8GRBGConvert, superpixelConvert, uint8_t, false, true)
+BAYER_KERNEL(superpixel8GBRGConvert, superpixelConvert, uint8_t, true, false)
+BAYER_KERNEL(superpixel8BGGRConvert, superpixelConvert, uint8_t, true, true)
+BAYER_KERNEL(bayer16RGGBConvert, bayerConvert, uint16_t, false, false)
+BAYER_KERNEL(bayer16GRBGConvert, bayerConvert, uint16_t, false, true)
+BAYER_KERNEL(bayer16GBRGConvert, bayerConvert, uint16_t, true, false)
+BAYER_KERNEL(bayer16BGGRConvert, bayerConvert, uint16_t, true, true)
+BAYER_KERNEL(superpixel16RGGBConvert, superpixelConvert, uint16_t, false, false)
+BAYER_KERNEL(superpixel16GRBGConvert, superpixelConvert, uint16_t, false, true)
+BAYER_KERNEL(superpixel16GBRGConvert, superpixelConvert, uint16_t, true, false)
+BAYER_KERNEL(superpixel16BGGRConvert, superpixelConvert, uint16_t, true, true)
+
+#undef BAYER_KERNEL
+
+/**
+ * Unpacks 12 bit samples packed two into three bytes into 16 bit samples
+ * with the 12 bits at the top. MS_FIRST: the first byte holds the upper 8
+ * bits of the first sample, the second byte the lower 4 bits of the first
+ * (low nibble) and second sample (high nibble), and the third byte the upper
+ * 8 bits of the second sample. Otherwise, the first byte holds the lower 8
+ * bits of the first sample and the second byte its upper 4 bits in the low
+ * nibble.
+ */
+template <bool MS_FIRST>
+inline void unpack12(const uint8_t *__restrict packed, std::size_t pairs, uint16_t *__restrict samples) noexcept {
+    for (std::size_t i{0}; i < pairs; i++) {
+        const uint32_t b0{packed[3 * i]};
+        const uint32_t b1{packed[3 * i + 1]};
+        const uint32_t b2{packed[3 * i + 2]};
+        samples[2 * i]     = static_cast<uint16_t>(MS_FIRST ? ((b0 << 8) | ((b1 & 0x0F) << 4)) : (((b1 & 0x0F) << 12) | (b0 << 4)));
+        samples[2 * i + 1] = static_cast<uint16_t>((b2 << 8) | (b1 & 0xF0));
+    }
+}
+
+PIPELINE_SIMD_CLONES
+void unpack12MsFirst(const uint8_t *packed, std::size_t count, uint16_t *samples) noexcept {
+    unpack12<true>(packed, count / 2, samples);
+}
+
+PIPELINE_SIMD_CLONES
+void unpack12LsFirst(const uint8_t *packed, std::size_t count, uint16_t *samples) noexcept {
+    unpack12<false>(packed, count / 2, samples);
+}
+
+/**
+ * Converts big-endian 16 bit samples into host order.
+ */
+PIPELINE_SIMD_CLONES
+void unpack16(const uint8_t *__restrict bigEndian, std::size_t count, uint16_t *__restrict samples) noexcept {
+    for (std::size_t i{0}; i < count; i++) {
+        samples[i] = static_cast<uint16_t>((bigEndian[2 * i] << 8) | bigEndian[2 * i + 1]);
+    }
+}
+
+}  // namespace
+
+BayerConverter::Kernel BayerConverter::kernel(BayerFormat format, BayerPattern pattern, Demosaic demosaic) noexcept {
+    static const Kernel KERNELS[2][2][4]{
+        {{bayer8RGGBConvert, bayer8GRBGConvert, bayer8GBRGConvert, bayer8BGGRConvert},
+         {superpixel8RGGBConvert, superpixel8GRBGConvert, superpixel8GBRGConvert, superpixel8BGGRConvert}},
+        {{bayer16RGGBConvert, bayer16GRBGConvert, bayer16GBRGConvert, bayer16BGGRConvert},
+         {superpixel16RGGBConvert, superpixel16GRBGConvert, superpixel16GBRGConvert, superpixel16BGGRConvert}}};
+    return KERNELS[(BayerFormat::BAYER8 == format) ? 0 : 1][(Demosaic::SUPERPIXEL == demosaic) ? 1 : 0][static_cast<uint8_t>(pattern) & 3];
+}
+
+BayerConverter::I420Rows BayerConverter::i420Rows(YuvMatrix yuvMatrix, YuvRange yuvRange) noexcept {
+    static const I420Rows I420_ROWS[2][2]{{bt601LimitedRows, bt601FullRows}, {bt709LimitedRows, bt709FullRows}};
+    return I420_ROWS[(YuvMatrix::BT709 == yuvMatrix) ? 1 : 0][(YuvRange::FULL == yuvRange) ? 1 : 0];
+}
+
+BayerConverter::Unpacker BayerConverter::unpacker(BayerFormat format) noexcept {
+    switch (format) {
+        case BayerFormat::BAYER12_PACKED: return unpack12LsFirst;
+        case BayerFormat::BAYER12_PACKED_MSFIRST: return unpack12MsFirst;
+        case BayerFormat::BAYER16: return unpack16;
+        case BayerFormat::BAYER8: break;
+    }
+    return nullptr;
+}
+
+BayerConverter::BayerConverter(uint32_t width, uint32_t height, BayerFormat format, BayerPattern pattern, Demosaic demosaic, WorkerPool &workers,
+                               YuvMatrix yuvMatrix, YuvRange yuvRange, uint16_t *raw16, ToneMapper *toneMapper, const BayerCorrection *correction)
+    : FrameConverter{outputSize(width, demosaic), outputSize(height, demosaic), workers, yuvMatrix, yuvRange}
+    , m_width{width}
+    , m_height{height}
+    , m_kernel{kernel((nullptr != toneMapper) ? BayerFormat::BAYER8 : format, pattern, demosaic)}
+    , m_i420Rows{i420Rows(yuvMatrix, yuvRange)}
+    , m_unpacker{unpacker(format)}
+    , m_bytesPerTwoSamples{(BayerFormat::BAYER16 == format) ? 4u : ((BayerFormat::BAYER8 == format) ? 2u : 3u)}
+    , m_raw16{raw16}
+    , m_toneMapper{toneMapper}
+    , m_correction{correction}
+    , m_rgbStride{stripeScratch(width, outputWidth(), BayerFormat::BAYER8 != format, nullptr != correction, nullptr != toneMapper)}
+    , m_rgb(m_rgbStride * stripes())
+    , m_samples((nullptr != m_unpacker) && (nullptr == raw16) ? width * height : 0)
+    , m_mapped((nullptr != toneMapper) ? width * height : 0) {
+    assert((4 <= width) && (0 == width % 2));
+    assert((4 <= height) && (0 == height % 2));
+    assert((0 == outputWidth() % 2) && (0 == outputHeight() % 2));
+    assert((nullptr == raw16) || (nullptr != m_unpacker));
+    assert((nullptr == toneMapper) || (nullptr != m_unpacker));
+    assert((nullptr == toneMapper) || (toneMapper->stripes() >= stripes()));
+}
+
+uint32_t BayerConverter::stripeScratch(uint32_t width, uint32_t outputWidth, bool wide, bool corrected, bool toneMapped) noexcept {
+    uint32_t size{0};
+    if (wide && !toneMapped) {
+        size = StripeRows<uint16_t>::size(outputWidth) + (corrected ? SourceRows<uint16_t>::size(width) : 0);
+    }
+    else {
+        size = StripeRows<uint8_t>::size(outputWidth) + ((corrected && !toneMapped) ? SourceRows<uint8_t>::size(width) : 0);
+    }
+    if (toneMapped) {
+        // Tone mapping borrows the row buffers for a corrected row, its
+        // correction gains, and its tone mapping gains.
+        size = std::max(size, 3 * width * static_cast<uint32_t>(sizeof(uint16_t)));
+    }
+    return (size + 63) & ~63u;
+}
+
+void BayerConverter::setColour(std::shared_ptr<const ColourCorrection> colour) noexcept {
+    std::atomic_store(&m_colour, std::move(colour));
+}
+
+void BayerConverter::convert(const uint8_t *bayer, uint8_t *y, uint8_t *u, uint8_t *v, uint8_t *argb) {
+    const uint8_t *frame{bayer};
+    if (nullptr != m_unpacker) {
+        // High bit depth frames are unpacked into 16 bit samples first; all
+        // stripes need to be done before demosaicing as each stripe also
+        // reads the rows next to it.
+        uint16_t *samples{(nullptr != m_raw16) ? m_raw16 : m_samples.data()};
+        const uint32_t rowsPerOutputRow{m_height / outputHeight()};
+        // Tone mapping (and correcting the rows before) right away unless
+        // the local operator needs to measure the whole frame first. It
+        // measures corrected samples as those are what it maps; the few rows
+        // it measures are corrected twice rather than keeping a corrected
+        // copy of the frame.
+        const bool local{(nullptr != m_toneMapper) && m_toneMapper->local()};
+        auto measure = [&](uint32_t stripe, uint32_t firstRow, uint32_t lastRow) {
+            if (nullptr == m_correction) {
+                m_toneMapper->measure(samples, firstRow, lastRow, stripe);
+                return;
+            }
+            uint16_t *corrected0{reinterpret_cast<uint16_t *>(m_rgb.data() + stripe * m_rgbStride)};
+            uint16_t *correctionGains{corrected0 + m_width};
+            uint16_t *corrected1{correctionGains + m_width};
+            for (uint32_t row{(firstRow + 7) & ~7u}; row + 1 < lastRow; row += 8) {
+                const uint16_t *source{samples + static_cast<std::size_t>(row) * m_width};
+                m_correction->correct(source, row, corrected0, correctionGains);
+                m_correction->correct(source + m_width, row + 1, corrected1, correctionGains);
+                m_toneMapper->measureRows(corrected0, corrected1, row, stripe);
+            }
+        };
+        auto toneMap = [&](uint32_t stripe, uint32_t firstRow, uint32_t lastRow) {
+            uint16_t *corrected{reinterpret_cast<uint16_t *>(m_rgb.data() + stripe * m_rgbStride)};
+            uint16_t *correctionGains{corrected + m_width};
+            uint16_t *toneMappingGains{correctionGains + m_width};
+            for (uint32_t row{firstRow * rowsPerOutputRow}; row < lastRow * rowsPerOutputRow; row++) {
+                const uint16_t *source{samples + static_cast<std::size_t>(row) * m_width};
+                if (nullptr != m_correction) {
+                    m_correction->correct(source, row, corrected, correctionGains);
+                    source = corrected;
+                }
+                m_toneMapper->map(source, row, m_mapped.data() + static_cast<std::size_t>(row) * m_width, toneMappingGains);
+            }
+        };
+        forEachStripe([&](uint32_t stripe, uint32_t firstRow, uint32_t lastRow) {
+            const std::size_t first{static_cast<std::size_t>(firstRow) * rowsPerOutputRow * m_width};
+            const std::size_t count{static_cast<std::size_t>(lastRow - firstRow) * rowsPerOutputRow * m_width};
+            m_unpacker(bayer + first / 2 * m_bytesPerTwoSamples, count, samples + first);
+            if (local) {
+                measure(stripe, firstRow * rowsPerOutputRow, lastRow * rowsPerOutputRow);
+            }
+            else if (nullptr != m_toneMapper) {
+                toneMap(stripe, firstRow, lastRow);
+            }
+        });
+        if (local) {
+            m_toneMapper->finishMeasuring();
+            forEachStripe(toneMap);
+        }
+        frame = (nullptr != m_toneMapper) ? m_mapped.data() : reinterpret_cast<const uint8_t *>(samples);
+    }
+    // Tone mapped frames have been corrected already. The colour correction
+    // is picked up once per frame and kept alive until the frame is done.
+    const std::shared_ptr<const ColourCorrection> colour{std::atomic_load(&m_colour)};
+    const Job job{frame, m_width, m_height, (nullptr != m_toneMapper) ? nullptr : m_correction, colour.get(), m_i420Rows, y, u, v, argb,
+                  nv12(), (nullptr != nv12()) ? nv12() + static_cast<std::size_t>(outputWidth()) * outputHeight() : nullptr, gray()};
+    forEachOutputStripe([&](uint32_t stripe, uint32_t firstRow, uint32_t lastRow) {
+        m_kernel(job, firstRow, lastRow, m_rgb.data() + stripe * m_rgbStride);
+    });
+}
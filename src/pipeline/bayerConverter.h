@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_BAYERCONVERTER_H
+#define PIPELINE_BAYERCONVERTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "pipeline/bayerCorrection.h"
+#include "pipeline/colourCorrection.h"
+#include "pipeline/frameConverter.h"
+#include "pipeline/toneMapper.h"
+#include "pipeline/workerPool.h"
+
+/**
+ * Colour filter array layout, named after the first two pixels of the first
+ * two rows. The values encode where red sits: bit 0 is set if red is in odd
+ * columns and bit 1 if red is in odd rows.
+ */
+enum class BayerPattern : uint8_t {
+    RGGB = 0,
+    GRBG = 1,
+    GBRG = 2,
+    BGGR = 3,
+};
+
+/**
+ * Sample layout of Bayer frames: one byte per sample, two 12 bit samples
+ * packed into three bytes (with the least or most significant bits first),
+ * or big-endian 16 bit samples.
+ */
+enum class BayerFormat : uint8_t {
+    BAYER8,
+    BAYER12_PACKED,
+    BAYER12_PACKED_MSFIRST,
+    BAYER16,
+};
+
+/**
+ * BILINEAR interpolates the missing colours of every pixel. SUPERPIXEL turns
+ * each 2x2 Bayer cell into one pixel without interpolating, which halves
+ * width and height and takes about a quarter of the work.
+ */
+enum class Demosaic : uint8_t {
+    BILINEAR,
+    SUPERPIXEL,
+};
+
+/**
+ * Converts Bayer frames into I420 and ARGB in a single sweep. Each
+ * pair of output rows is demosaiced into a few row buffers that stay in
+ * cache and is turned right away into two rows of Y and one row each of U
+ * and V in the given colour space as well as into two rows of ARGB. ARGB
+ * is taken from the demosaiced colours and hence keeps the full chroma
+ * resolution. No full-frame RGB image is ever written. NV12 chroma is
+ * interleaved while U and V are computed, and the rows of Y are copied to
+ * NV12 and GRAY8 while still in cache.
+ *
+ * The output is as large as the frame, or half as wide and high with
+ * Demosaic::SUPERPIXEL; then width and height must be multiples of 4.
+ *
+ * 12 and 16 bit frames are first unpacked into 16 bit samples with the
+ * significant bits at the top, either into an internal buffer or into the
+ * given raw16 image (width*height samples, host byte order) to publish them
+ * as well. They are demosaiced with 16 bit precision and only reduced to
+ * 8 bit for I420 and ARGB. With a ToneMapper, the unpacked samples are
+ * instead tone mapped to 8 bit and demosaiced like 8 bit frames.
+ *
+ * With a ColourCorrection, the demosaiced colours are white balanced,
+ * corrected by a matrix, and gamma corrected on their way to 8 bit; it
+ * can be replaced between frames while converting.
+ *
+ * With a BayerCorrection, every Bayer row is corrected right before it is
+ * demosaiced, into a few rows per stripe that stay in cache (or before it
+ * is tone mapped).
+ *
+ * Each sample size and pattern has its own specialised kernel, and each
+ * colour space its own I420 conversion with compile-time coefficients; both
+ * are picked once in the constructor, so there is no branching on the
+ * pattern or colour space per pixel. The rows above and below a stripe
+ * are read from the neighbouring stripes.
+ *
+ * Width and height must be even and at least 4.
+ */
+class BayerConverter : public FrameConverter {
+   private:
+    BayerConverter(const BayerConverter &) = delete;
+    BayerConverter(BayerConverter &&)      = delete;
+    BayerConverter &operator=(const BayerConverter &) = delete;
+    BayerConverter &operator=(BayerConverter &&) = delete;
+
+   public:
+    BayerConverter(uint32_t width, uint32_t height, BayerFormat format, BayerPattern pattern, Demosaic demosaic, WorkerPool &workers,
+                   YuvMatrix yuvMatrix = YuvMatrix::BT601, YuvRange yuvRange = YuvRange::LIMITED, uint16_t *raw16 = nullptr, ToneMapper *toneMapper = nullptr, const BayerCorrection *correction = nullptr);
+
+    static uint32_t outputSize(uint32_t size, Demosaic demosaic) noexcept {
+        return (Demosaic::SUPERPIXEL == demosaic) ? size / 2 : size;
+    }
+
+    /**
+     * Sets the colour correction of the frames converted from now on, or
+     * turns it off with nullptr; may be called from any thread.
+     */
+    void setColour(std::shared_ptr<const ColourCorrection> colour) noexcept;
+
+    void convert(const uint8_t *bayer, uint8_t *y, uint8_t *u, uint8_t *v, uint8_t *argb) override;
+
+    // The frame being converted and where its outputs go.
+    struct Job;
+
+   private:
+    // Converts the output rows [firstRow, lastRow) of a frame.
+    typedef void (*Kernel)(const Job &job, uint32_t firstRow, uint32_t lastRow, uint8_t *scratch);
+    static Kernel kernel(BayerFormat format, BayerPattern pattern, Demosaic demosaic) noexcept;
+    // Turns two rows of RGB into two rows of Y and one row each of U and V,
+    // and of U and V interleaved unless uv is nullptr.
+    typedef void (*I420Rows)(const uint8_t *r0, const uint8_t *g0, const uint8_t *b0, const uint8_t *r1, const uint8_t *g1, const uint8_t *b1,
+                             uint32_t width, uint8_t *y0, uint8_t *y1, uint8_t *u, uint8_t *v, uint8_t *uv);
+    static I420Rows i420Rows(YuvMatrix yuvMatrix, YuvRange yuvRange) noexcept;
+    // Unpacks count samples.
+    typedef void (*Unpacker)(const uint8_t *packed, std::size_t count, uint16_t *samples);
+    static Unpacker unpacker(BayerFormat format) noexcept;
+    // Bytes of row buffers per stripe.
+    static uint32_t stripeScratch(uint32_t width, uint32_t outputWidth, bool wide, bool corrected, bool toneMapped) noexcept;
+
+   private:
+    const uint32_t m_width;
+    const uint32_t m_height;
+    const Kernel m_kernel;
+    const I420Rows m_i420Rows;
+    const Unpacker m_unpacker;
+    const uint32_t m_bytesPerTwoSamples;
+    uint16_t *m_raw16;
+    ToneMapper *m_toneMapper;
+    const BayerCorrection *m_correction;
+    // Only accessed with std::atomic_load and std::atomic_store.
+    std::shared_ptr<const ColourCorrection> m_colour{};
+    // R, G, and B of the two rows being converted and the corrected Bayer
+    // rows they are made from, per stripe and padded to whole cache lines.
+    const uint32_t m_rgbStride;
+    std::vector<uint8_t> m_rgb;
+    // Unpacked 16 bit samples unless they go to raw16.
+    std::vector<uint16_t> m_samples;
+    // Tone mapped samples.
+    std::vector<uint8_t> m_mapped;
+};
+
+#endif
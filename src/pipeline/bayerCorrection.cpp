@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline/bayerCorrection.h"
+#include "pipeline/vectorize.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+namespace {
+
+/**
+ * Subtracts the black level from a row and multiplies it by the gains,
+ * rounding to nearest; (maxValue * 65535) plus the rounding still fits
+ * into 32 bits for 16 bit samples.
+ */
+template <typename T>
+inline void correctRow(const T *__restrict row, const uint16_t *__restrict gains, uint32_t width, uint32_t black, uint32_t maxValue,
+                       T *__restrict out) noexcept {
+    const uint32_t half{1u << (BayerCorrection::GAIN_BITS - 1)};
+    for (std::size_t x{0}; x < width; x++) {
+        const uint32_t v{std::max<uint32_t>(row[x], black) - black};
+        out[x] = static_cast<T>(std::min((v * gains[x] + half) >> BayerCorrection::GAIN_BITS, maxValue));
+    }
+}
+
+PIPELINE_SIMD_CLONES
+void correctRow8(const uint8_t *row, const uint16_t *gains, uint32_t width, uint32_t black, uint32_t maxValue, uint8_t *out) noexcept {
+    correctRow(row, gains, width, black, maxValue, out);
+}
+
+PIPELINE_SIMD_CLONES
+void correctRow16(const uint16_t *row, const uint16_t *gains, uint32_t width, uint32_t black, uint32_t maxValue, uint16_t *out) noexcept {
+    correctRow(row, gains, width, black, maxValue, out);
+}
+
+/**
+ * Reads the next line that is neither empty nor a comment.
+ */
+bool nextLine(std::istream &in, std::string &line) {
+    while (std::getline(in, line)) {
+        const std::size_t first{line.find_first_not_of(" \t\r")};
+        if ( (std::string::npos != first) && ('#' != line[first]) ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+BayerCorrection::BayerCorrection(uint32_t width, uint32_t height, uint32_t maxValue, uint32_t black)
+    : m_width{width}
+    , m_height{height}
+    , m_maxValue{maxValue}
+    , m_black{black}
+    , m_gridGains(2 * width)
+    , m_defectStart(height + 1, 0)
+    , m_defects{} {
+    assert((2 <= width) && (2 <= height));
+    assert(black < maxValue / 2);
+    // Without shading, every pixel only gets the gain that stretches the
+    // range above the black level.
+    const double stretch{static_cast<double>(maxValue) / static_cast<double>(maxValue - black)};
+    std::fill(m_gridGains.begin(), m_gridGains.end(), static_cast<uint16_t>(std::lround(stretch * (1u << GAIN_BITS))));
+}
+
+bool BayerCorrection::loadDefects(const std::string &path) {
+    std::ifstream in{path};
+    if (!in.good()) {
+        return false;
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> defects;
+    std::string line;
+    while (nextLine(in, line)) {
+        std::istringstream fields{line};
+        int64_t x{-1};
+        int64_t y{-1};
+        if (!(fields >> x >> y) || (x < 0) || (y < 0) || (x >= m_width) || (y >= m_height)) {
+            return false;
+        }
+        defects.emplace_back(static_cast<uint32_t>(y), static_cast<uint32_t>(x));
+    }
+    std::sort(defects.begin(), defects.end());
+    defects.erase(std::unique(defects.begin(), defects.end()), defects.end());
+
+    // Pick the replacements now: every defect is replaced with the nearest
+    // intact pixels of its colour, skipping over neighbouring defects, so a
+    // corrected row never depends on the order the defects are fixed in.
+    auto defective = [&defects](uint32_t y, uint32_t x) {
+        return std::binary_search(defects.begin(), defects.end(), std::make_pair(y, x));
+    };
+    m_defects.clear();
+    std::fill(m_defectStart.begin(), m_defectStart.end(), 0);
+    for (const auto &defect : defects) {
+        const uint32_t y{defect.first};
+        const uint32_t x{defect.second};
+        int64_t left{static_cast<int64_t>(x) - 2};
+        while ( (left >= 0) && defective(y, static_cast<uint32_t>(left)) ) {
+            left -= 2;
+        }
+        uint32_t right{x + 2};
+        while ( (right < m_width) && defective(y, right) ) {
+            right += 2;
+        }
+        // Without an intact pixel of its colour in the row, the defect is kept.
+        const uint32_t leftSource{(left >= 0) ? static_cast<uint32_t>(left) : ((right < m_width) ? right : x)};
+        const uint32_t rightSource{(right < m_width) ? right : leftSource};
+        m_defectStart[y + 1]++;
+        m_defects.push_back(Defect{x, leftSource, rightSource});
+    }
+    for (uint32_t y{0}; y < m_height; y++) {
+        m_defectStart[y + 1] += m_defectStart[y];
+    }
+    return true;
+}
+
+bool BayerCorrection::loadShading(const std::string &path) {
+    std::ifstream in{path};
+    std::string line;
+    if (!in.good() || !nextLine(in, line)) {
+        return false;
+    }
+    uint32_t columns{0};
+    uint32_t rows{0};
+    {
+        std::istringstream fields{line};
+        if (!(fields >> columns >> rows) || (columns < 2) || (rows < 2) || (columns > m_width) || (rows > m_height)) {
+            return false;
+        }
+    }
+    std::vector<double> nodes;
+    while (nextLine(in, line)) {
+        std::istringstream fields{line};
+        double gain{0.0};
+        while (fields >> gain) {
+            if ( (gain < 0.0) || (gain >= 16.0) ) {
+                return false;
+            }
+            nodes.push_back(gain);
+        }
+        if (!fields.eof()) {
+            return false;
+        }
+    }
+    if (nodes.size() != static_cast<std::size_t>(columns) * rows * 4) {
+        return false;
+    }
+
+    // Interpolate every grid row along the frame's columns, separately for
+    // even and odd frame rows.
+    const double stretch{static_cast<double>(m_maxValue) / static_cast<double>(m_maxValue - m_black)};
+    std::vector<uint16_t> gridGains(static_cast<std::size_t>(rows) * 2 * m_width);
+    for (uint32_t r{0}; r < rows; r++) {
+        for (uint32_t parity{0}; parity < 2; parity++) {
+            uint16_t *gains{gridGains.data() + (static_cast<std::size_t>(r) * 2 + parity) * m_width};
+            for (uint32_t x{0}; x < m_width; x++) {
+                const double position{static_cast<double>(x) * (columns - 1) / (m_width - 1)};
+                const uint32_t column{std::min(static_cast<uint32_t>(position), columns - 2)};
+                const double weight{position - column};
+                const uint32_t channel{parity * 2 + (x & 1)};
+                const double left{nodes[(static_cast<std::size_t>(r) * columns + column) * 4 + channel]};
+                const double right{nodes[(static_cast<std::size_t>(r) * columns + column + 1) * 4 + channel]};
+                const double gain{(left + (right - left) * weight) * stretch * (1u << GAIN_BITS)};
+                gains[x] = static_cast<uint16_t>(std::min(std::lround(gain), 0xFFFFl));
+            }
+        }
+    }
+    m_gridRows = rows;
+    m_gridGains.swap(gridGains);
+    return true;
+}
+
+const uint16_t *BayerCorrection::rowGains(uint32_t y, uint16_t *gains) const noexcept {
+    const uint32_t parity{y & 1};
+    if (1 == m_gridRows) {
+        return m_gridGains.data() + parity * m_width;
+    }
+    const uint32_t position{y * (m_gridRows - 1)};
+    const uint32_t gridRow{position / (m_height - 1)};
+    const uint32_t weight{(((position % (m_height - 1)) << 12) + (m_height - 1) / 2) / (m_height - 1)};
+    const uint16_t *__restrict upper{m_gridGains.data() + (static_cast<std::size_t>(gridRow) * 2 + parity) * m_width};
+    if (0 == weight) {
+        return upper;
+    }
+    const uint16_t *__restrict lower{upper + 2 * m_width};
+    uint16_t *__restrict blended{gains};
+    for (std::size_t x{0}; x < m_width; x++) {
+        blended[x] = static_cast<uint16_t>((upper[x] * (4096 - weight) + lower[x] * weight + 2048) >> 12);
+    }
+    return blended;
+}
+
+template <typename T>
+void BayerCorrection::replaceDefects(uint32_t y, T *out) const noexcept {
+    for (uint32_t i{m_defectStart[y]}; i < m_defectStart[y + 1]; i++) {
+        const Defect &defect{m_defects[i]};
+        out[defect.column] = static_cast<T>((out[defect.left] + out[defect.right] + 1) >> 1);
+    }
+}
+
+void BayerCorrection::correct(const uint8_t *row, uint32_t y, uint8_t *out, uint16_t *gains) const noexcept {
+    correctRow8(row, rowGains(y, gains), m_width, m_black, m_maxValue, out);
+    replaceDefects(y, out);
+}
+
+void BayerCorrection::correct(const uint16_t *row, uint32_t y, uint16_t *out, uint16_t *gains) const noexcept {
+    correctRow16(row, rowGains(y, gains), m_width, m_black, m_maxValue, out);
+    replaceDefects(y, out);
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_BAYERCORRECTION_H
+#define PIPELINE_BAYERCORRECTION_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Corrects Bayer rows before demosaicing:
+ *
+ *  - the black level is subtracted and the remaining range is stretched
+ *    back to the full range,
+ *  - lens shading is compensated by a gain per pixel that is interpolated
+ *    bilinearly from a coarse grid with one gain per position in the 2x2
+ *    Bayer cell at every node, and
+ *  - defective pixels are replaced by the average of the nearest intact
+ *    pixels of the same colour to their left and right, or by the one
+ *    intact pixel on the other side at the frame border or next to a run of
+ *    defects.
+ *
+ * Black level and shading are folded into one fixed point gain per pixel.
+ * The grid is interpolated along the rows once when it is loaded, so a row
+ * costs one blend of two gain rows, one multiply per pixel, and a lookup
+ * per defect in it. Coordinates are those of the frames as delivered
+ * (after region of interest, binning, and flipping).
+ */
+class BayerCorrection {
+   private:
+    BayerCorrection(const BayerCorrection &) = delete;
+    BayerCorrection(BayerCorrection &&)      = delete;
+    BayerCorrection &operator=(const BayerCorrection &) = delete;
+    BayerCorrection &operator=(BayerCorrection &&) = delete;
+
+   public:
+    // Gains are fixed point with GAIN_BITS fractional bits.
+    static const uint32_t GAIN_BITS{12};
+
+    /**
+     * @param width Width of the frames.
+     * @param height Height of the frames.
+     * @param maxValue Largest sample value: 255 or 65535.
+     * @param black Black level on the scale of maxValue; less than half of it.
+     */
+    BayerCorrection(uint32_t width, uint32_t height, uint32_t maxValue, uint32_t black);
+
+    /**
+     * Loads defective pixels from a text file with one "x y" per line;
+     * lines starting with # are skipped.
+     *
+     * @return false if the file cannot be read or a pixel is outside the frame.
+     */
+    bool loadDefects(const std::string &path);
+
+    /**
+     * Loads lens shading gains from a text file that starts with the number
+     * of grid columns and rows (at least 2 each), followed by four gains
+     * (in [0, 16)) per node, row by row. The nodes are spread evenly over
+     * the frame from corner to corner; the gains of a node are for the
+     * pixels at even row/even column, even/odd, odd/even, and odd/odd.
+     * Lines starting with # are skipped.
+     *
+     * @return false if the file cannot be read or is malformed.
+     */
+    bool loadShading(const std::string &path);
+
+    /**
+     * Corrects row y of a frame into out.
+     *
+     * @param gains Room for width gains.
+     */
+    void correct(const uint8_t *row, uint32_t y, uint8_t *out, uint16_t *gains) const noexcept;
+    void correct(const uint16_t *row, uint32_t y, uint16_t *out, uint16_t *gains) const noexcept;
+
+   private:
+    // Gains of row y, either one of the grid rows or blended into gains.
+    const uint16_t *rowGains(uint32_t y, uint16_t *gains) const noexcept;
+
+    template <typename T>
+    void replaceDefects(uint32_t y, T *out) const noexcept;
+
+   private:
+    const uint32_t m_width;
+    const uint32_t m_height;
+    const uint32_t m_maxValue;
+    const uint32_t m_black;
+    // Gains of every column for even and odd frame rows at each grid row.
+    uint32_t m_gridRows{1};
+    std::vector<uint16_t> m_gridGains;
+    // A defective pixel and the columns of the intact pixels it is replaced with.
+    struct Defect {
+        uint32_t column;
+        uint32_t left;
+        uint32_t right;
+    };
+    // The defective pixels of row y are m_defects[m_defectStart[y]] to m_defects[m_defectStart[y + 1] - 1].
+    std::vector<uint32_t> m_defectStart;
+    std::vector<Defect> m_defects;
+};
+
+#endif
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline/bayerDownsampler.h"
+#include "pipeline/vectorize.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+/**
+ * Reads the 8 most significant bits of the two samples of Bayer cell
+ * column cx in a frame row.
+ */
+template <BayerFormat FORMAT>
+inline void cellSamples(const uint8_t *__restrict row, std::size_t cx, uint32_t &s0, uint32_t &s1) noexcept {
+    switch (FORMAT) {
+        case BayerFormat::BAYER8:
+            s0 = row[2 * cx];
+            s1 = row[2 * cx + 1];
+            break;
+        case BayerFormat::BAYER12_PACKED:
+            // Lower 8 bits of the first sample, its upper 4 bits and the
+            // lower 4 bits of the second sample, upper 8 bits of the second.
+            s0 = ((row[3 * cx + 1] & 0x0Fu) << 4) | (row[3 * cx] >> 4);
+            s1 = row[3 * cx + 2];
+            break;
+        case BayerFormat::BAYER12_PACKED_MSFIRST:
+            s0 = row[3 * cx];
+            s1 = row[3 * cx + 2];
+            break;
+        case BayerFormat::BAYER16:
+            // Big-endian.
+            s0 = row[4 * cx];
+            s1 = row[4 * cx + 2];
+            break;
+    }
+}
+
+std::size_t rowBytes(uint32_t width, BayerFormat format) noexcept {
+    switch (format) {
+        case BayerFormat::BAYER8: return width;
+        case BayerFormat::BAYER12_PACKED:
+        case BayerFormat::BAYER12_PACKED_MSFIRST: return static_cast<std::size_t>(width) / 2 * 3;
+        case BayerFormat::BAYER16: return static_cast<std::size_t>(width) * 2;
+    }
+    return width;
+}
+
+/**
+ * Adds the samples of a row of Bayer cells to the sums of R, G, and B per
+ * cell column. Red sits in odd rows if RED_ROW_ODD and in odd columns if
+ * RED_COLUMN_ODD, blue diagonally across, and green in the other two.
+ */
+template <BayerFormat FORMAT, bool RED_ROW_ODD, bool RED_COLUMN_ODD>
+inline void addCellRow(const uint8_t *__restrict row0, const uint8_t *__restrict row1, std::size_t cellColumns,
+                       uint32_t *__restrict r, uint32_t *__restrict g, uint32_t *__restrict b) noexcept {
+    for (std::size_t cx{0}; cx < cellColumns; cx++) {
+        uint32_t s00{0}, s01{0}, s10{0}, s11{0};
+        cellSamples<FORMAT>(row0, cx, s00, s01);
+        cellSamples<FORMAT>(row1, cx, s10, s11);
+        const uint32_t red{RED_ROW_ODD ? (RED_COLUMN_ODD ? s11 : s10) : (RED_COLUMN_ODD ? s01 : s00)};
+        const uint32_t blue{RED_ROW_ODD ? (RED_COLUMN_ODD ? s00 : s01) : (RED_COLUMN_ODD ? s10 : s11)};
+        r[cx] += red;
+        g[cx] += s00 + s01 + s10 + s11 - red - blue;
+        b[cx] += blue;
+    }
+}
+
+// One entry point per sample layout and pattern, so that the choice is made
+// once and every loop is compiled for each target of PIPELINE_SIMD_CLONES.
+#define CELL_ROWS(NAME, FORMAT, RED_ROW_ODD, RED_COLUMN_ODD)                                                                        \
+    PIPELINE_SIMD_CLONES                                                                                                             \
+    void NAME(const uint8_t *row0, const uint8_t *row1, std::size_t cellColumns, uint32_t *r, uint32_t *g, uint32_t *b) noexcept {  \
+        addCellRow<FORMAT, RED_ROW_ODD, RED_COLUMN_ODD>(row0, row1, cellColumns, r, g, b);                                          \
+    }
+
+CELL_ROWS(cellRows8RGGB, BayerFormat::BAYER8, false, false)
+CELL_ROWS(cellRows8GRBG, BayerFormat::BAYER8, false, true)
+CELL_ROWS(cellRows8GBRG, BayerFormat::BAYER8, true, false)
+CELL_ROWS(cellRows8BGGR, BayerFormat::BAYER8, true, true)
+CELL_ROWS(cellRows12RGGB, BayerFormat::BAYER12_PACKED, false, false)
+CELL_ROWS(cellRows12GRBG, BayerFormat::BAYER12_PACKED, false, true)
+CELL_ROWS(cellRows12GBRG, BayerFormat::BAYER12_PACKED, true, false)
+CELL_ROWS(cellRows12BGGR, BayerFormat::BAYER12_PACKED, true, true)
+CELL_ROWS(cellRows12MsFirstRGGB, BayerFormat::BAYER12_PACKED_MSFIRST, false, false)
+CELL_ROWS(cellRows12MsFirstGRBG, BayerFormat::BAYER12_PACKED_MSFIRST, false, true)
+CELL_ROWS(cellRows12MsFirstGBRG, BayerFormat::BAYER12_PACKED_MSFIRST, true, false)
+CELL_ROWS(cellRows12MsFirstBGGR, BayerFormat::BAYER12_PACKED_MSFIRST, true, true)
+CELL_ROWS(cellRows16RGGB, BayerFormat::BAYER16, false, false)
+CELL_ROWS(cellRows16GRBG, BayerFormat::BAYER16, false, true)
+CELL_ROWS(cellRows16GBRG, BayerFormat::BAYER16, true, false)
+CELL_ROWS(cellRows16BGGR, BayerFormat::BAYER16, true, true)
+
+#undef CELL_ROWS
+
+// Splits [0, count) evenly into parts and returns the start of each part
+// followed by count.
+std::vector<uint32_t> split(uint32_t count, uint32_t parts) {
+    std::vector<uint32_t> starts(parts + 1);
+    for (uint32_t i{0}; i <= parts; i++) {
+        starts[i] = static_cast<uint32_t>(static_cast<uint64_t>(count) * i / parts);
+    }
+    return starts;
+}
+
+}  // namespace
+
+void BayerDownsampler::downsampleRows(const uint8_t *bayer, uint8_t *rgb, uint32_t firstRow, uint32_t lastRow, uint32_t *sums) const noexcept {
+    uint32_t *r{sums};
+    uint32_t *g{sums + m_cellColumns};
+    uint32_t *b{sums + 2 * m_cellColumns};
+    for (uint32_t y{firstRow}; y < lastRow; y++) {
+        // Sum up the cell rows of this output row per cell column.
+        std::fill(sums, sums + 3 * m_cellColumns, 0u);
+        const uint32_t firstCellRow{m_rowStart[y]};
+        const uint32_t lastCellRow{m_rowStart[y + 1]};
+        for (uint32_t cy{firstCellRow}; cy < lastCellRow; cy++) {
+            const uint8_t *row0{bayer + 2 * cy * m_stride};
+            m_cellRows(row0, row0 + m_stride, m_cellColumns, r, g, b);
+        }
+        uint8_t *out{rgb + static_cast<std::size_t>(y) * m_outputWidth * 3};
+        for (uint32_t x{0}; x < m_outputWidth; x++) {
+            const uint32_t firstCell{m_columnStart[x]};
+            const uint32_t lastCell{m_columnStart[x + 1]};
+            uint32_t red{0}, green{0}, blue{0};
+            for (uint32_t cx{firstCell}; cx < lastCell; cx++) {
+                red += r[cx];
+                green += g[cx];
+                blue += b[cx];
+            }
+            const uint32_t cells{(lastCell - firstCell) * (lastCellRow - firstCellRow)};
+            out[3 * x]     = static_cast<uint8_t>((red + cells / 2) / cells);
+            out[3 * x + 1] = static_cast<uint8_t>((green + cells) / (2 * cells));
+            out[3 * x + 2] = static_cast<uint8_t>((blue + cells / 2) / cells);
+        }
+    }
+}
+
+BayerDownsampler::CellRows BayerDownsampler::cellRows(BayerFormat format, BayerPattern pattern) noexcept {
+    static const CellRows CELL_ROWS[4][4]{
+        {cellRows8RGGB, cellRows8GRBG, cellRows8GBRG, cellRows8BGGR},
+        {cellRows12RGGB, cellRows12GRBG, cellRows12GBRG, cellRows12BGGR},
+        {cellRows12MsFirstRGGB, cellRows12MsFirstGRBG, cellRows12MsFirstGBRG, cellRows12MsFirstBGGR},
+        {cellRows16RGGB, cellRows16GRBG, cellRows16GBRG, cellRows16BGGR}};
+    return CELL_ROWS[static_cast<uint8_t>(format) & 3][static_cast<uint8_t>(pattern) & 3];
+}
+
+BayerDownsampler::BayerDownsampler(uint32_t width, uint32_t height, BayerFormat format, BayerPattern pattern, uint32_t outputWidth,
+                                   uint32_t outputHeight, WorkerPool &workers)
+    : m_outputWidth{outputWidth}
+    , m_outputHeight{outputHeight}
+    , m_stride{rowBytes(width, format)}
+    , m_cellColumns{width / 2}
+    , m_cellRows{cellRows(format, pattern)}
+    , m_workers{workers}
+    , m_tasks{std::max(1u, std::min(workers.size(), outputHeight))}
+    , m_columnStart{split(width / 2, outputWidth)}
+    , m_rowStart{split(height / 2, outputHeight)}
+    , m_sums(3 * static_cast<std::size_t>(m_cellColumns) * m_tasks) {
+    assert((0 < outputWidth) && (outputWidth <= width / 2));
+    assert((0 < outputHeight) && (outputHeight <= height / 2));
+}
+
+void BayerDownsampler::downsample(const uint8_t *bayer, uint8_t *rgb) {
+    m_workers.run(m_tasks, [&](uint32_t task) {
+        downsampleRows(bayer, rgb, m_outputHeight * task / m_tasks, m_outputHeight * (task + 1) / m_tasks,
+                       m_sums.data() + 3 * static_cast<std::size_t>(m_cellColumns) * task);
+    });
+}
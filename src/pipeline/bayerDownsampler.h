@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_BAYERDOWNSAMPLER_H
+#define PIPELINE_BAYERDOWNSAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pipeline/bayerConverter.h"
+#include "pipeline/workerPool.h"
+
+/**
+ * Shrinks Bayer frames straight into small RGB24 images (R, G, and B per
+ * pixel) without demosaicing them first. Each output pixel averages the
+ * red, green, and blue samples of a block of whole 2x2 Bayer cells; the
+ * blocks tile the frame, so every sample is read exactly once.
+ *
+ * Samples are taken from the frame as delivered by the camera; 12 and 16
+ * bit samples are reduced to their 8 most significant bits while they are
+ * read. The output must not be larger than one pixel per Bayer cell.
+ */
+class BayerDownsampler {
+   private:
+    BayerDownsampler(const BayerDownsampler &) = delete;
+    BayerDownsampler(BayerDownsampler &&)      = delete;
+    BayerDownsampler &operator=(const BayerDownsampler &) = delete;
+    BayerDownsampler &operator=(BayerDownsampler &&) = delete;
+
+   public:
+    BayerDownsampler(uint32_t width, uint32_t height, BayerFormat format, BayerPattern pattern, uint32_t outputWidth, uint32_t outputHeight,
+                     WorkerPool &workers);
+
+    /**
+     * @param bayer Frame as delivered by the camera.
+     * @param rgb outputWidth x outputHeight RGB24 pixels.
+     */
+    void downsample(const uint8_t *bayer, uint8_t *rgb);
+
+   private:
+    // Adds the samples of a row of Bayer cells to the sums of R, G, and B
+    // per cell column.
+    typedef void (*CellRows)(const uint8_t *row0, const uint8_t *row1, std::size_t cellColumns, uint32_t *r, uint32_t *g, uint32_t *b);
+    static CellRows cellRows(BayerFormat format, BayerPattern pattern) noexcept;
+
+    // Downsamples the output rows [firstRow, lastRow), summing up cell rows
+    // in sums.
+    void downsampleRows(const uint8_t *bayer, uint8_t *rgb, uint32_t firstRow, uint32_t lastRow, uint32_t *sums) const noexcept;
+
+   private:
+    const uint32_t m_outputWidth;
+    const uint32_t m_outputHeight;
+    const std::size_t m_stride;
+    const uint32_t m_cellColumns;
+    const CellRows m_cellRows;
+    WorkerPool &m_workers;
+    const uint32_t m_tasks;
+    // First cell column of every output column and first cell row of every
+    // output row, each followed by the end of the last one.
+    std::vector<uint32_t> m_columnStart;
+    std::vector<uint32_t> m_rowStart;
+    // Sums of R, G, and B of every cell column, per task.
+    std::vector<uint32_t> m_sums;
+};
+
+#endif
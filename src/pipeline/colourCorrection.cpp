@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline/colourCorrection.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+bool ColourCorrection::Parameters::load(const std::string &path) {
+    std::ifstream in{path};
+    if (!in.good()) {
+        return false;
+    }
+    Parameters parameters;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields{line};
+        std::string key;
+        if (!(fields >> key) || ('#' == key[0])) {
+            continue;
+        }
+        bool valid{true};
+        if ("gamma" == key) {
+            valid = (fields >> parameters.gamma) && (parameters.gamma > 0.0f);
+        }
+        else if ("white_balance" == key) {
+            for (float &gain : parameters.whiteBalance) {
+                valid = valid && (fields >> gain) && (gain > 0.0f) && (gain < 16.0f);
+            }
+        }
+        else if ("matrix" == key) {
+            for (float &coefficient : parameters.matrix) {
+                valid = valid && (fields >> coefficient) && (coefficient > -8.0f) && (coefficient < 8.0f);
+            }
+        }
+        else {
+            valid = false;
+        }
+        std::string rest;
+        if (!valid || (fields >> rest)) {
+            return false;
+        }
+    }
+    *this = parameters;
+    return true;
+}
+
+ColourCorrection::ColourCorrection(const Parameters &parameters) noexcept
+    : m_matrix{}
+    , m_lut{} {
+    // Scaling the input channels by the white balance gains scales the
+    // matrix columns.
+    for (uint32_t i{0}; i < 9; i++) {
+        const float coefficient{parameters.matrix[i] * parameters.whiteBalance[i % 3]};
+        m_matrix[i] = static_cast<int32_t>(std::lround(std::min(std::max(coefficient, -8.0f), 8.0f) * (1 << MATRIX_BITS)));
+    }
+    const float last{static_cast<float>((1u << LUT_BITS) - 1)};
+    for (uint32_t i{0}; i < (1u << LUT_BITS); i++) {
+        m_lut[i] = static_cast<uint8_t>(std::lround(255.0f * std::pow(static_cast<float>(i) / last, 1.0f / parameters.gamma)));
+    }
+}
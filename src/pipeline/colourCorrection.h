@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_COLOURCORRECTION_H
+#define PIPELINE_COLOURCORRECTION_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * White balance, colour correction matrix, and gamma applied in software to
+ * demosaiced RGB, so that colour tuning does not need to stop the camera's
+ * stream.
+ *
+ * White balance gains are folded into the matrix, which is stored in fixed
+ * point with MATRIX_BITS fractional bits and applied to samples reduced to
+ * LUT_BITS bits. Gamma is a table from those LUT_BITS bits to the 8 bit
+ * output. An instance never changes after construction; new parameters
+ * take effect by swapping in a new instance between frames.
+ */
+class ColourCorrection {
+   private:
+    ColourCorrection(const ColourCorrection &) = delete;
+    ColourCorrection(ColourCorrection &&)      = delete;
+    ColourCorrection &operator=(const ColourCorrection &) = delete;
+    ColourCorrection &operator=(ColourCorrection &&) = delete;
+
+   public:
+    static const uint32_t MATRIX_BITS{12};
+    static const uint32_t LUT_BITS{12};
+
+    struct Parameters {
+        float gamma{1.0f};
+        // Red, green, and blue gains in (0, 16).
+        float whiteBalance[3]{1.0f, 1.0f, 1.0f};
+        // Row-major; rows give red, green, and blue from red, green, and
+        // blue, with coefficients in (-8, 8).
+        float matrix[9]{1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+
+        /**
+         * Reads parameters from a text file with lines "gamma <value>",
+         * "white_balance <red> <green> <blue>", and "matrix <9 values>";
+         * missing lines keep their defaults and lines starting with # are
+         * skipped.
+         *
+         * @return false if the file cannot be read or is malformed.
+         */
+        bool load(const std::string &path);
+    };
+
+    explicit ColourCorrection(const Parameters &parameters) noexcept;
+
+    const int32_t *matrix() const noexcept {
+        return m_matrix;
+    }
+
+    const uint8_t *lut() const noexcept {
+        return m_lut;
+    }
+
+   private:
+    int32_t m_matrix[9];
+    uint8_t m_lut[1u << LUT_BITS];
+};
+
+#endif
@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_FRAMECLOCK_H
+#define PIPELINE_FRAMECLOCK_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/**
+ * Maps the camera's frame clock (FRAME_DESC::fFrameTime, seconds since the
+ * camera started) onto the host clock (microseconds since epoch) while the
+ * two clocks drift apart.
+ *
+ * A frame can only arrive after it was taken, so the host arrival time is
+ * the true time plus a positive, heavy-tailed SDK and transport delay. Of
+ * each block of frames, only the one with the smallest (arrival - camera
+ * time) difference is kept; these block minima lie close to the lower
+ * envelope of all arrivals. A linear regression of the last N block minima
+ * yields the offset and the skew between both clocks. Corrected timestamps
+ * are read off the fitted line and hence carry no arrival jitter; the line
+ * only moves once per block.
+ *
+ * Adding a frame is O(1): the regression sums are updated incrementally
+ * per block and rebuilt from scratch once per window to bound rounding
+ * errors. Until enough blocks are collected, the smallest difference seen
+ * so far is used as offset with a skew of 0. The estimation starts over
+ * when the camera clock or the frame number goes backwards, e.g., after
+ * the stream was restarted.
+ */
+class FrameClock {
+   public:
+    /**
+     * @param blocks Number of block minima in the regression window.
+     * @param framesPerBlock Number of frames of which the minimum is kept.
+     */
+    explicit FrameClock(uint32_t blocks = 120, uint32_t framesPerBlock = 30) noexcept
+        : m_blocks(std::max(blocks, uint32_t{MIN_BLOCKS}))
+        , m_framesPerBlock(std::max(framesPerBlock, uint32_t{1})) {
+        m_window.reserve(m_blocks);
+    }
+
+    /**
+     * The mapping is only as precise as cameraTime. FRAME_DESC::fFrameTime is
+     * a 32 bit float that resolves about 1 ms after 2.3 hours and 8 ms after
+     * a day of camera uptime; pass the time recovered by FrameTime instead.
+     *
+     * @param cameraTime Camera frame time in seconds.
+     * @param frameNumber Camera frame number.
+     * @param arrivalUs Host time in microseconds at which the frame arrived.
+     * @return Camera time in microseconds on the host clock.
+     */
+    int64_t map(double cameraTime, uint32_t frameNumber, int64_t arrivalUs) noexcept {
+        const int64_t cameraUs{static_cast<int64_t>(std::llround(cameraTime * 1000.0 * 1000.0))};
+        if (!m_started || (cameraUs < m_lastCameraUs) || (frameNumber < m_lastFrameNumber)) {
+            reset(cameraUs, arrivalUs);
+        }
+        m_lastCameraUs    = cameraUs;
+        m_lastFrameNumber = frameNumber;
+
+        const Sample sample{cameraUs, arrivalUs};
+        if ((0 == m_inBlock) || (delay(sample) < delay(m_blockMin))) {
+            m_blockMin = sample;
+        }
+        if (++m_inBlock == m_framesPerBlock) {
+            m_inBlock = 0;
+            addBlock(m_blockMin);
+        }
+
+        if (!m_fitted) {
+            m_minDelayUs = std::min(m_minDelayUs, delay(sample));
+            m_skew       = 0.0;
+            m_offsetUs   = m_minDelayUs;
+            return cameraUs + m_offsetUs;
+        }
+        const double x{static_cast<double>(cameraUs - m_refCameraUs)};
+        const int64_t hostUs{m_refArrivalUs + static_cast<int64_t>(std::llround(m_intercept + (1.0 + m_skew) * x))};
+        m_offsetUs = hostUs - cameraUs;
+        return hostUs;
+    }
+
+    /**
+     * @return Offset in microseconds between host and camera clock at the last mapped frame.
+     */
+    int64_t offsetUs() const noexcept {
+        return m_offsetUs;
+    }
+
+    /**
+     * @return Rate of the host clock relative to the camera clock minus 1 (e.g., 10e-6 for 10 ppm).
+     */
+    double skew() const noexcept {
+        return m_skew;
+    }
+
+   private:
+    struct Sample {
+        int64_t cameraUs;
+        int64_t arrivalUs;
+    };
+
+    static int64_t delay(const Sample &sample) noexcept {
+        return sample.arrivalUs - sample.cameraUs;
+    }
+
+    void reset(int64_t cameraUs, int64_t arrivalUs) noexcept {
+        m_started      = true;
+        m_fitted       = false;
+        m_inBlock      = 0;
+        m_window.clear();
+        m_next         = 0;
+        m_refCameraUs  = cameraUs;
+        m_refArrivalUs = arrivalUs;
+        m_minDelayUs   = std::numeric_limits<int64_t>::max();
+        m_sx = m_sy = m_sxx = m_sxy = 0.0;
+    }
+
+    void addBlock(const Sample &sample) noexcept {
+        if (m_window.size() < m_blocks) {
+            m_window.push_back(sample);
+            accumulate(sample, 1.0);
+        }
+        else {
+            accumulate(m_window[m_next], -1.0);
+            m_window[m_next] = sample;
+            accumulate(sample, 1.0);
+        }
+        m_next = (m_next + 1) % m_blocks;
+        if (0 == m_next) {
+            rebuild();
+        }
+        if (m_window.size() >= MIN_BLOCKS) {
+            m_fitted = fit() || m_fitted;
+        }
+    }
+
+    void accumulate(const Sample &sample, double sign) noexcept {
+        const double x{static_cast<double>(sample.cameraUs - m_refCameraUs)};
+        const double y{static_cast<double>(sample.arrivalUs - m_refArrivalUs)};
+        m_sx += sign * x;
+        m_sy += sign * y;
+        m_sxx += sign * x * x;
+        m_sxy += sign * x * y;
+    }
+
+    void rebuild() noexcept {
+        // Move the reference to the oldest block to keep the sums small. The
+        // intercept is re-derived against the new reference so that the last
+        // line stays valid should the following fit() fail.
+        const Sample reference{m_window[m_next]};
+        const double x{static_cast<double>(reference.cameraUs - m_refCameraUs)};
+        m_intercept += (1.0 + m_skew) * x - static_cast<double>(reference.arrivalUs - m_refArrivalUs);
+        m_refCameraUs  = reference.cameraUs;
+        m_refArrivalUs = reference.arrivalUs;
+        m_sx = m_sy = m_sxx = m_sxy = 0.0;
+        for (const Sample &sample : m_window) {
+            accumulate(sample, 1.0);
+        }
+    }
+
+    bool fit() noexcept {
+        const double n{static_cast<double>(m_window.size())};
+        const double denominator{n * m_sxx - m_sx * m_sx};
+        if (!(denominator > 0.0)) {
+            return false;
+        }
+        const double slope{(n * m_sxy - m_sx * m_sy) / denominator};
+        m_intercept = (m_sy - slope * m_sx) / n;
+        m_skew      = slope - 1.0;
+        return true;
+    }
+
+   private:
+    static constexpr uint32_t MIN_BLOCKS{4};
+
+    const uint32_t m_blocks;
+    const uint32_t m_framesPerBlock;
+
+    bool m_started{false};
+    bool m_fitted{false};
+    uint32_t m_inBlock{0};
+    Sample m_blockMin{0, 0};
+    std::vector<Sample> m_window{};
+    std::size_t m_next{0};
+
+    int64_t m_refCameraUs{0};
+    int64_t m_refArrivalUs{0};
+    double m_sx{0.0};
+    double m_sy{0.0};
+    double m_sxx{0.0};
+    double m_sxy{0.0};
+    double m_intercept{0.0};
+    double m_skew{0.0};
+
+    int64_t m_minDelayUs{std::numeric_limits<int64_t>::max()};
+    int64_t m_offsetUs{0};
+    int64_t m_lastCameraUs{0};
+    uint32_t m_lastFrameNumber{0};
+};
+
+#endif
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_FRAMECONVERTER_H
+#define PIPELINE_FRAMECONVERTER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "pipeline/workerPool.h"
+#include "pipeline/yuvColourSpace.h"
+
+/**
+ * Turns a camera frame into I420 and, optionally, ARGB. The output may be
+ * smaller than the frame; its width and height are even.
+ *
+ * Conversion is split into horizontal stripes that run in parallel on the
+ * given WorkerPool, one stripe per worker. Stripes start on even output rows
+ * so that each one covers whole rows of U and V.
+ *
+ * yuvMatrix() and yuvRange() tell how the I420 image encodes colours.
+ *
+ * Stripe handlers can work on the output of each stripe right after it
+ * has been written, on the same worker and while it is still in cache.
+ *
+ * The image can also be written as NV12 and GRAY8 along with I420; each
+ * converter writes them together with the I420 rows they are made of.
+ */
+class FrameConverter {
+   private:
+    FrameConverter(const FrameConverter &) = delete;
+    FrameConverter(FrameConverter &&)      = delete;
+    FrameConverter &operator=(const FrameConverter &) = delete;
+    FrameConverter &operator=(FrameConverter &&) = delete;
+
+   public:
+    typedef std::function<void(uint32_t firstRow, uint32_t lastRow)> StripeHandler;
+
+    virtual ~FrameConverter() = default;
+
+    uint32_t outputWidth() const noexcept {
+        return m_outputWidth;
+    }
+    uint32_t outputHeight() const noexcept {
+        return m_outputHeight;
+    }
+    YuvMatrix yuvMatrix() const noexcept {
+        return m_yuvMatrix;
+    }
+    YuvRange yuvRange() const noexcept {
+        return m_yuvRange;
+    }
+
+    /**
+     * @param frame Frame as delivered by the camera.
+     * @param y Y plane with outputWidth() bytes per row.
+     * @param u U plane with outputWidth()/2 bytes per row.
+     * @param v V plane with outputWidth()/2 bytes per row.
+     * @param argb ARGB image with 4*outputWidth() bytes per row or nullptr.
+     */
+    virtual void convert(const uint8_t *frame, uint8_t *y, uint8_t *u, uint8_t *v, uint8_t *argb) = 0;
+
+    /**
+     * Adds a handler(firstRow, lastRow) that is called for every stripe of
+     * output rows [firstRow, lastRow) once convert has written it. Stripes
+     * then start on multiples of rowAlignment, a power of two.
+     */
+    void addStripeHandler(StripeHandler handler, uint32_t rowAlignment) {
+        m_stripeHandlers.push_back(std::move(handler));
+        m_rowAlignment = std::max(m_rowAlignment, rowAlignment);
+    }
+
+    /**
+     * Makes convert also write the image as NV12 (the Y plane followed by U
+     * and V interleaved) into nv12 and its Y plane alone into gray; either
+     * may be nullptr.
+     */
+    void setExtraOutputs(uint8_t *nv12, uint8_t *gray) noexcept {
+        m_nv12 = nv12;
+        m_gray = gray;
+    }
+
+   protected:
+    FrameConverter(uint32_t outputWidth, uint32_t outputHeight, WorkerPool &workers,
+                   YuvMatrix yuvMatrix = YuvMatrix::BT601, YuvRange yuvRange = YuvRange::LIMITED)
+        : m_outputWidth{outputWidth}
+        , m_outputHeight{outputHeight}
+        , m_yuvMatrix{yuvMatrix}
+        , m_yuvRange{yuvRange}
+        , m_workers{workers}
+        , m_stripes{std::max(1u, std::min(workers.size(), outputHeight / 2))} {}
+
+    uint32_t stripes() const noexcept {
+        return m_stripes;
+    }
+    uint8_t *nv12() const noexcept {
+        return m_nv12;
+    }
+    uint8_t *gray() const noexcept {
+        return m_gray;
+    }
+
+    /**
+     * Runs task(stripe, firstRow, lastRow) for every stripe of output rows
+     * [firstRow, lastRow) and returns when all are done. A stripe may be
+     * empty.
+     */
+    void forEachStripe(const std::function<void(uint32_t, uint32_t, uint32_t)> &task) {
+        const uint32_t units{m_outputHeight / m_rowAlignment};
+        m_workers.run(m_stripes, [&](uint32_t stripe) {
+            const uint32_t lastRow{(stripe + 1 == m_stripes) ? m_outputHeight : m_rowAlignment * (units * (stripe + 1) / m_stripes)};
+            task(stripe, m_rowAlignment * (units * stripe / m_stripes), lastRow);
+        });
+    }
+
+    /**
+     * Like forEachStripe for the pass that writes the outputs; runs the
+     * stripe handlers on each stripe after task.
+     */
+    void forEachOutputStripe(const std::function<void(uint32_t, uint32_t, uint32_t)> &task) {
+        forEachStripe([&](uint32_t stripe, uint32_t firstRow, uint32_t lastRow) {
+            task(stripe, firstRow, lastRow);
+            for (const auto &handler : m_stripeHandlers) {
+                handler(firstRow, lastRow);
+            }
+        });
+    }
+
+   private:
+    const uint32_t m_outputWidth;
+    const uint32_t m_outputHeight;
+    const YuvMatrix m_yuvMatrix;
+    const YuvRange m_yuvRange;
+    WorkerPool &m_workers;
+    const uint32_t m_stripes;
+    std::vector<StripeHandler> m_stripeHandlers{};
+    uint32_t m_rowAlignment{2};
+    uint8_t *m_nv12{nullptr};
+    uint8_t *m_gray{nullptr};
+};
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_FRAMECOUNTERS_H
+#define PIPELINE_FRAMECOUNTERS_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * Counts lost or late frames separately for every place where they can get
+ * lost, from the camera down to the shared memory consumers. The counters
+ * may be read from any thread; see the methods for who may update them.
+ */
+class FrameCounters {
+   public:
+    // Frames missing in the camera's frame numbering (lost on the camera or the bus).
+    std::atomic<uint64_t> cameraGaps{0};
+    // Failed calls into the PixeLINK SDK while acquiring.
+    std::atomic<uint64_t> sdkErrors{0};
+    // Frames drained and dropped because every pool buffer was still in use.
+    std::atomic<uint64_t> poolExhausted{0};
+    // Frames dropped because the queue to the conversion loop was full.
+    std::atomic<uint64_t> queueFull{0};
+    // Frames skipped on purpose to meet the requested frequency.
+    std::atomic<uint64_t> decimated{0};
+    // Frames published by the conversion loop.
+    std::atomic<uint64_t> published{0};
+    // Shared memory locks that were held by a consumer for longer than the stall threshold.
+    std::atomic<uint64_t> lockStalls{0};
+    // Frames whose conversion took longer than the camera's frame period.
+    std::atomic<uint64_t> conversionOverruns{0};
+
+   public:
+    /**
+     * Called by the producer (capture thread or frame callback) for every
+     * frame in the order in which the SDK delivers them.
+     */
+    void captured(uint32_t frameNumber) noexcept {
+        if (m_hasFrameNumber && (frameNumber > m_lastFrameNumber)) {
+            // Frames dropped from our own pool in between were not lost by the camera.
+            const uint64_t missing{frameNumber - m_lastFrameNumber - 1};
+            if (missing > m_unnumberedDrops) {
+                cameraGaps.fetch_add(missing - m_unnumberedDrops, std::memory_order_relaxed);
+            }
+        }
+        m_hasFrameNumber  = true;
+        m_lastFrameNumber = frameNumber;
+        m_unnumberedDrops = 0;
+    }
+
+    /**
+     * Called by the producer for a frame that was drained without a
+     * FRAME_DESC because the pool was exhausted.
+     */
+    void droppedFromPool() noexcept {
+        poolExhausted.fetch_add(1, std::memory_order_relaxed);
+        m_unnumberedDrops++;
+    }
+
+   private:
+    // Producer state.
+    bool m_hasFrameNumber{false};
+    uint32_t m_lastFrameNumber{0};
+    uint64_t m_unnumberedDrops{0};
+};
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_FRAMEPACER_H
+#define PIPELINE_FRAMEPACER_H
+
+/**
+ * Decimates a stream of frames to a target frequency based on the frames'
+ * own timestamps. Frames are due every 1/frequency seconds; a frame is
+ * accepted if it is closer to the next due time than half an input frame
+ * interval, so the accepted frames keep the target rate on average even if
+ * it does not divide the camera's frame rate. Input at or below the target
+ * frequency passes unchanged.
+ */
+class FramePacer {
+   public:
+    explicit FramePacer(float frequency) noexcept
+        : m_period{(frequency > 0.0f) ? 1.0 / static_cast<double>(frequency) : 0.0} {}
+
+    /**
+     * @param time Frame time in seconds.
+     * @return true if the frame should be processed.
+     */
+    bool accept(double time) noexcept {
+        const double interval{m_started ? time - m_lastTime : 0.0};
+        const bool restarted{m_started && (interval < 0.0)};
+        m_lastTime = time;
+        if (!m_started || restarted || !(m_period > 0.0)) {
+            m_started = true;
+            m_due     = time + m_period;
+            return true;
+        }
+        if (time < m_due - interval / 2.0) {
+            return false;
+        }
+        m_due += m_period;
+        if (m_due < time) {
+            // Fell behind (e.g., after frames were lost); do not try to catch up.
+            m_due = time + m_period;
+        }
+        return true;
+    }
+
+   private:
+    const double m_period;
+    bool m_started{false};
+    double m_lastTime{0.0};
+    double m_due{0.0};
+};
+
+#endif
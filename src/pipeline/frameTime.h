@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_FRAMETIME_H
+#define PIPELINE_FRAMETIME_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+/**
+ * Recovers the camera frame time at full precision from the 32 bit float
+ * FRAME_DESC::fFrameTime.
+ *
+ * A float has 24 significant bits: after 2.3 hours of camera uptime,
+ * fFrameTime only resolves about 1 ms, after a day about 8 ms. The time of
+ * a frame is therefore predicted from the previous frame's time plus the
+ * number of frame periods passed according to uFrameNumber and the nominal
+ * frame rate. fFrameTime only corrects this prediction: the true time lies
+ * within half a float step around fFrameTime, so the prediction is clamped
+ * into that interval. The prediction starts over from fFrameTime when the
+ * frame number goes backwards or the frame rate is unknown.
+ */
+class FrameTime {
+   public:
+    /**
+     * @param frameTime FRAME_DESC::fFrameTime in seconds.
+     * @param frameNumber FRAME_DESC::uFrameNumber.
+     * @param frameRate FRAME_DESC::FrameRate.fValue in frames per second.
+     * @return Camera frame time in seconds.
+     */
+    double reconstruct(float frameTime, uint32_t frameNumber, float frameRate) noexcept {
+        const double coarse{static_cast<double>(frameTime)};
+        double time{coarse};
+        if (m_started && (frameNumber > m_lastFrameNumber) && (frameRate > 0.0f)) {
+            const double lower{(coarse + static_cast<double>(std::nextafter(frameTime, -std::numeric_limits<float>::infinity()))) / 2.0};
+            const double upper{(coarse + static_cast<double>(std::nextafter(frameTime, std::numeric_limits<float>::infinity()))) / 2.0};
+            const double predicted{m_lastTime + static_cast<double>(frameNumber - m_lastFrameNumber) / static_cast<double>(frameRate)};
+            time = std::min(std::max(predicted, lower), upper);
+        }
+        m_started         = true;
+        m_lastTime        = time;
+        m_lastFrameNumber = frameNumber;
+        return time;
+    }
+
+   private:
+    bool m_started{false};
+    double m_lastTime{0.0};
+    uint32_t m_lastFrameNumber{0};
+};
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_LATENCYSTATS_H
+#define PIPELINE_LATENCYSTATS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+/**
+ * Minimum, mean, and maximum of latency samples in microseconds since the
+ * last reset. Not thread-safe; samples are meant to be added and read by
+ * the same thread.
+ */
+class LatencyStats {
+   public:
+    void add(int64_t latencyUs) noexcept {
+        m_count++;
+        m_sum += latencyUs;
+        m_min = std::min(m_min, latencyUs);
+        m_max = std::max(m_max, latencyUs);
+    }
+
+    void reset() noexcept {
+        *this = LatencyStats();
+    }
+
+    uint64_t count() const noexcept {
+        return m_count;
+    }
+    int64_t min() const noexcept {
+        return (0 < m_count) ? m_min : 0;
+    }
+    int64_t max() const noexcept {
+        return (0 < m_count) ? m_max : 0;
+    }
+    int64_t mean() const noexcept {
+        return (0 < m_count) ? m_sum / static_cast<int64_t>(m_count) : 0;
+    }
+
+   private:
+    uint64_t m_count{0};
+    int64_t m_sum{0};
+    int64_t m_min{std::numeric_limits<int64_t>::max()};
+    int64_t m_max{std::numeric_limits<int64_t>::min()};
+};
+
+#endif
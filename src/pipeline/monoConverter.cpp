@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline/monoConverter.h"
+#include "pipeline/vectorize.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+
+namespace {
+
+/**
+ * Writes grey values as ARGB, that is the same value in B, G, and R and 255
+ * in A (one little-endian 32 bit word per pixel, like libyuv).
+ */
+PIPELINE_SIMD_CLONES
+void greyToARGB(const uint8_t *__restrict grey, std::size_t count, uint32_t *__restrict argb) noexcept {
+    for (std::size_t i{0}; i < count; i++) {
+        argb[i] = 0xFF000000u | (static_cast<uint32_t>(grey[i]) * 0x010101u);
+    }
+}
+
+/**
+ * Maps grey values through a table.
+ */
+void greyToY(const uint8_t *__restrict grey, std::size_t count, const uint8_t *__restrict table, uint8_t *__restrict y) noexcept {
+    for (std::size_t i{0}; i < count; i++) {
+        y[i] = table[grey[i]];
+    }
+}
+
+}  // namespace
+
+MonoConverter::MonoConverter(uint32_t width, uint32_t height, WorkerPool &workers, YuvRange yuvRange)
+    : FrameConverter{width, height, workers, YuvMatrix::BT601, yuvRange}
+    , m_limited{} {
+    for (uint32_t i{0}; i < 256; i++) {
+        m_limited[i] = static_cast<uint8_t>(16 + (i * 219 + 127) / 255);
+    }
+    assert((2 <= width) && (0 == width % 2));
+    assert((2 <= height) && (0 == height % 2));
+}
+
+void MonoConverter::convert(const uint8_t *grey, uint8_t *y, uint8_t *u, uint8_t *v, uint8_t *argb) {
+    // The chroma is the same for every frame, so it is only written once
+    // per shared memory area: when the planes show up at a new address,
+    // i.e., after attaching. Consumers only read it.
+    const std::size_t chromaSize{(outputWidth() / 2) * (outputHeight() / 2)};
+    if ( (u != m_u) || (v != m_v) ) {
+        std::memset(u, 128, chromaSize);
+        std::memset(v, 128, chromaSize);
+        m_u = u;
+        m_v = v;
+    }
+    const std::size_t size{static_cast<std::size_t>(outputWidth()) * outputHeight()};
+    uint8_t *uv{(nullptr != nv12()) ? nv12() + size : nullptr};
+    if ((nullptr != uv) && (uv != m_uv)) {
+        std::memset(uv, 128, 2 * chromaSize);
+        m_uv = uv;
+    }
+
+    const std::size_t width{outputWidth()};
+    forEachOutputStripe([&](uint32_t, uint32_t firstRow, uint32_t lastRow) {
+        const std::size_t first{firstRow * width};
+        const std::size_t count{(lastRow - firstRow) * width};
+        if (YuvRange::FULL == yuvRange()) {
+            std::memcpy(y + first, grey + first, count);
+        }
+        else {
+            greyToY(grey + first, count, m_limited, y + first);
+        }
+        // The Y plane of the stripe is still in cache.
+        if (nullptr != nv12()) {
+            std::memcpy(nv12() + first, y + first, count);
+        }
+        if (nullptr != gray()) {
+            std::memcpy(gray() + first, y + first, count);
+        }
+        if (nullptr != argb) {
+            greyToARGB(grey + first, count, reinterpret_cast<uint32_t *>(argb) + first);
+        }
+    });
+}
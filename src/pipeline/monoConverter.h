@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_MONOCONVERTER_H
+#define PIPELINE_MONOCONVERTER_H
+
+#include <cstdint>
+
+#include "pipeline/frameConverter.h"
+#include "pipeline/workerPool.h"
+
+/**
+ * Publishes 8 bit grey frames as I420 and ARGB without any colour
+ * processing: with YuvRange::FULL the frame is the Y plane, with
+ * YuvRange::LIMITED it is scaled into [16, 235] on the way. U and V (and
+ * the chroma of NV12) are constant 128 and written once per shared memory
+ * area rather than per frame. ARGB repeats the grey value in B, G, and R.
+ *
+ * Width and height must be even.
+ */
+class MonoConverter : public FrameConverter {
+   private:
+    MonoConverter(const MonoConverter &) = delete;
+    MonoConverter(MonoConverter &&)      = delete;
+    MonoConverter &operator=(const MonoConverter &) = delete;
+    MonoConverter &operator=(MonoConverter &&) = delete;
+
+   public:
+    MonoConverter(uint32_t width, uint32_t height, WorkerPool &workers, YuvRange yuvRange = YuvRange::FULL);
+
+    void convert(const uint8_t *grey, uint8_t *y, uint8_t *u, uint8_t *v, uint8_t *argb) override;
+
+   private:
+    // Grey to limited range Y.
+    uint8_t m_limited[256];
+    // Chroma planes that already hold the neutral 128.
+    const uint8_t *m_u{nullptr};
+    const uint8_t *m_v{nullptr};
+    const uint8_t *m_uv{nullptr};
+};
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline/pyramid.h"
+#include "pipeline/vectorize.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+namespace {
+
+/**
+ * Averages the 2x2 blocks of the rows [2*firstRow, 2*lastRow) of a plane
+ * into the rows [firstRow, lastRow) of a plane of half the size.
+ */
+PIPELINE_SIMD_CLONES
+void halveRows(const uint8_t *in, uint32_t inWidth, uint8_t *out, uint32_t outWidth, uint32_t firstRow, uint32_t lastRow) noexcept {
+    for (std::size_t y{firstRow}; y < lastRow; y++) {
+        const uint8_t *__restrict row0{in + 2 * y * inWidth};
+        const uint8_t *__restrict row1{row0 + inWidth};
+        uint8_t *__restrict o{out + y * outWidth};
+        for (std::size_t x{0}; x < outWidth; x++) {
+            o[x] = static_cast<uint8_t>((row0[2 * x] + row0[2 * x + 1] + row1[2 * x] + row1[2 * x + 1] + 2) >> 2);
+        }
+    }
+}
+
+}  // namespace
+
+Pyramid::Pyramid(uint32_t width, uint32_t height, const uint8_t *image, const std::vector<uint8_t *> &levels)
+    : m_planes{} {
+    assert((0 == width % 2) && (0 == height % 2));
+    const std::size_t size{static_cast<std::size_t>(width) * height};
+    // Only the levels write to their planes.
+    uint8_t *full{const_cast<uint8_t *>(image)};
+    m_planes.push_back(Plane{full, width, height});
+    m_planes.push_back(Plane{full + size, width / 2, height / 2});
+    m_planes.push_back(Plane{full + size + size / 4, width / 2, height / 2});
+    for (uint32_t level{1}; level <= levels.size(); level++) {
+        const uint32_t levelWidth{Pyramid::levelWidth(width, level)};
+        const uint32_t levelHeight{Pyramid::levelHeight(height, level)};
+        const std::size_t levelSize{static_cast<std::size_t>(levelWidth) * levelHeight};
+        uint8_t *data{levels[level - 1]};
+        m_planes.push_back(Plane{data, levelWidth, levelHeight});
+        m_planes.push_back(Plane{data + levelSize, levelWidth / 2, levelHeight / 2});
+        m_planes.push_back(Plane{data + levelSize + levelSize / 4, levelWidth / 2, levelHeight / 2});
+    }
+}
+
+void Pyramid::downscale(uint32_t firstRow, uint32_t lastRow) const noexcept {
+    // Each level is made from the rows of the level above that this stripe
+    // has just written.
+    for (std::size_t i{3}; i < m_planes.size(); i++) {
+        const Plane &in{m_planes[i - 3]};
+        const Plane &out{m_planes[i]};
+        // Chroma planes have half as many rows.
+        const uint32_t shift{static_cast<uint32_t>(i / 3) + ((0 == i % 3) ? 0u : 1u)};
+        halveRows(in.data, in.width, out.data, out.width, firstRow >> shift, std::min(lastRow >> shift, out.height));
+    }
+}
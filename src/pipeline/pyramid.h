@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_PYRAMID_H
+#define PIPELINE_PYRAMID_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Downscales an I420 image into further I420 images at 1/2, 1/4, ... of its
+ * width and height by averaging 2x2 blocks, each level from the one above.
+ * Level sizes are rounded down to even numbers.
+ *
+ * downscale works on a stripe of rows of the full image right after it has
+ * been written (see FrameConverter::addStripeHandler); stripes must start
+ * on multiples of rowAlignment() so that they cover whole rows of U and V
+ * on every level. Stripes can be downscaled in parallel.
+ */
+class Pyramid {
+   private:
+    Pyramid(const Pyramid &) = delete;
+    Pyramid(Pyramid &&)      = delete;
+    Pyramid &operator=(const Pyramid &) = delete;
+    Pyramid &operator=(Pyramid &&) = delete;
+
+   public:
+    /**
+     * @param width Width of the full image; even.
+     * @param height Height of the full image; even.
+     * @param image The full I420 image.
+     * @param levels One I420 image per level below the full image, of
+     *        levelWidth(width, level) x levelHeight(height, level) pixels
+     *        for level 1, 2, ...
+     */
+    Pyramid(uint32_t width, uint32_t height, const uint8_t *image, const std::vector<uint8_t *> &levels);
+
+    static uint32_t levelWidth(uint32_t width, uint32_t level) noexcept {
+        return (width >> level) & ~1u;
+    }
+    static uint32_t levelHeight(uint32_t height, uint32_t level) noexcept {
+        return (height >> level) & ~1u;
+    }
+
+    uint32_t rowAlignment() const noexcept {
+        return 2u << (m_planes.size() / 3 - 1);
+    }
+
+    /**
+     * Downscales the rows [firstRow, lastRow) of the full image.
+     */
+    void downscale(uint32_t firstRow, uint32_t lastRow) const noexcept;
+
+   private:
+    struct Plane {
+        uint8_t *data;
+        uint32_t width;
+        uint32_t height;
+    };
+    // Y, U, and V of the full image followed by those of every level.
+    std::vector<Plane> m_planes;
+};
+
+#endif
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_SPSCRING_H
+#define PIPELINE_SPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/**
+ * Bounded lock-free queue for exactly one producer thread and exactly one
+ * consumer thread. One slot is kept empty to tell "full" from "empty", hence
+ * the ring holds at most capacity elements.
+ */
+template <typename T>
+class SpscRing {
+   private:
+    SpscRing(const SpscRing &) = delete;
+    SpscRing(SpscRing &&)      = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+    SpscRing &operator=(SpscRing &&) = delete;
+
+   public:
+    explicit SpscRing(std::size_t capacity)
+        : m_slots(capacity + 1)
+        , m_head{0}
+        , m_tail{0} {}
+
+    /**
+     * Called from the producer thread only.
+     * @return false if the ring is full; value is left untouched in that case.
+     */
+    bool push(T &&value) noexcept {
+        const std::size_t tail{m_tail.load(std::memory_order_relaxed)};
+        const std::size_t next{increment(tail)};
+        if (next == m_head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        m_slots[tail] = std::move(value);
+        m_tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Called from the consumer thread only.
+     * @return false if the ring is empty.
+     */
+    bool pop(T &value) noexcept {
+        const std::size_t head{m_head.load(std::memory_order_relaxed)};
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = std::move(m_slots[head]);
+        m_head.store(increment(head), std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Called from the consumer thread only.
+     * @return true if pop() would fail.
+     */
+    bool empty() const noexcept {
+        return m_head.load(std::memory_order_relaxed) == m_tail.load(std::memory_order_acquire);
+    }
+
+    std::size_t capacity() const noexcept {
+        return m_slots.size() - 1;
+    }
+
+   private:
+    std::size_t increment(std::size_t index) const noexcept {
+        return (index + 1 == m_slots.size()) ? 0 : index + 1;
+    }
+
+   private:
+    std::vector<T> m_slots;
+    // Keep producer and consumer indices on separate cache lines.
+    alignas(64) std::atomic<std::size_t> m_head;
+    alignas(64) std::atomic<std::size_t> m_tail;
+};
+
+#endif
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_TELEMETRY_H
+#define PIPELINE_TELEMETRY_H
+
+#include <cstdint>
+
+/**
+ * Layout of the telemetry shared memory area. The record is overwritten
+ * for every published frame; readers should check version first.
+ */
+struct Telemetry {
+    static constexpr uint32_t VERSION{4};
+
+    uint32_t version;
+    uint32_t frameNumber;   // FRAME_DESC::uFrameNumber
+    int64_t cameraTimeUs;   // rebuilt by FrameTime from frame number and rate
+    int64_t timestampUs;    // as set in the image shared memory areas
+    int64_t clockOffsetUs;  // host clock - camera clock
+    double clockSkew;       // host clock rate / camera clock rate - 1
+    uint32_t yuvMatrix;     // YuvMatrix of the I420 image
+    uint32_t yuvRange;      // YuvRange of the I420 image
+
+    // Running totals since start-up, see FrameCounters.
+    uint64_t published;
+    uint64_t cameraGaps;
+    uint64_t sdkErrors;
+    uint64_t poolExhausted;
+    uint64_t queueFull;
+    uint64_t lockStalls;
+    uint64_t conversionOverruns;
+    uint64_t decimated;
+};
+
+static_assert(sizeof(Telemetry) == 112, "Telemetry layout must not depend on the compiler.");
+
+#endif
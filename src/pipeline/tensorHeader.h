@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_TENSORHEADER_H
+#define PIPELINE_TENSORHEADER_H
+
+#include <cstdint>
+
+/**
+ * Element type of a tensor.
+ */
+enum class TensorType : uint32_t {
+    UINT8   = 0,
+    FLOAT16 = 1,
+};
+
+/**
+ * Layout of the start of the tensor shared memory area; the tensor itself
+ * follows at DATA_OFFSET as planar batch x channels x height x width
+ * elements (NCHW). Readers should check version first.
+ */
+struct TensorHeader {
+    static constexpr uint32_t VERSION{1};
+    static constexpr uint32_t DATA_OFFSET{64};
+
+    uint32_t version;
+    uint32_t type;      // TensorType
+    uint32_t batch;     // always 1
+    uint32_t channels;  // always 3: R, G, B or, if bgr is set, B, G, R
+    uint32_t height;
+    uint32_t width;
+    uint32_t bgr;
+    // Letterbox: the image is scaled by scale and placed with its top left
+    // corner at (left, top); the rest is padding.
+    float scale;
+    uint32_t left;
+    uint32_t top;
+    // Float16 elements are (value / 255 - mean) / stddev per channel in the
+    // order of the tensor; uint8 elements are the plain values.
+    float mean[3];
+    float stddev[3];
+};
+
+static_assert(sizeof(TensorHeader) <= TensorHeader::DATA_OFFSET, "TensorHeader must fit in front of the tensor.");
+
+#endif
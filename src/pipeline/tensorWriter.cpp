@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline/tensorWriter.h"
+#include "pipeline/vectorize.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+/**
+ * Returns the bits of the float16 nearest to value.
+ */
+uint16_t float16Bits(float value) noexcept {
+    uint32_t bits{0};
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign{static_cast<uint16_t>((bits >> 16) & 0x8000u)};
+    const int32_t exponent{static_cast<int32_t>((bits >> 23) & 0xFFu) - 127 + 15};
+    uint32_t mantissa{bits & 0x7FFFFFu};
+    if (exponent >= 31) {
+        return static_cast<uint16_t>(sign | 0x7C00u);
+    }
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return sign;
+        }
+        // Subnormal.
+        mantissa |= 0x800000u;
+        const uint32_t shift{static_cast<uint32_t>(14 - exponent)};
+        return static_cast<uint16_t>(sign | ((mantissa + (1u << (shift - 1))) >> shift));
+    }
+    // Rounding may carry into the exponent, which is still correct.
+    return static_cast<uint16_t>(sign | ((static_cast<uint32_t>(exponent) << 10) + ((mantissa + 0x1000u) >> 13)));
+}
+
+/**
+ * Maps each tensor position along one axis to the source position to its
+ * left (or above) and the weight of the next source position in 1/256,
+ * sampling at pixel centres.
+ */
+void samplePositions(uint32_t sourceSize, uint32_t size, std::vector<uint32_t> &positions, std::vector<uint32_t> &weights) {
+    positions.resize(size);
+    weights.resize(size);
+    const float step{static_cast<float>(sourceSize) / static_cast<float>(size)};
+    for (uint32_t i{0}; i < size; i++) {
+        const float position{std::min(std::max((static_cast<float>(i) + 0.5f) * step - 0.5f, 0.0f), static_cast<float>(sourceSize - 1))};
+        positions[i] = std::min(static_cast<uint32_t>(position), sourceSize - 1);
+        weights[i]   = (positions[i] + 1 < sourceSize) ? static_cast<uint32_t>(std::lround((position - static_cast<float>(positions[i])) * 256.0f)) : 0u;
+    }
+}
+
+/**
+ * Blends two rows of ARGB with the weight of the lower row in 1/256 and
+ * splits them into rows of B, G, and R in 1/256.
+ */
+PIPELINE_SIMD_CLONES
+void blendRows(const uint32_t *__restrict above, const uint32_t *__restrict below, uint32_t weight, uint32_t width,
+               uint16_t *__restrict b, uint16_t *__restrict g, uint16_t *__restrict r) noexcept {
+    const uint32_t aboveWeight{256 - weight};
+    for (std::size_t x{0}; x < width; x++) {
+        const uint32_t a{above[x]};
+        const uint32_t c{below[x]};
+        b[x] = static_cast<uint16_t>((a & 0xFFu) * aboveWeight + (c & 0xFFu) * weight);
+        g[x] = static_cast<uint16_t>(((a >> 8) & 0xFFu) * aboveWeight + ((c >> 8) & 0xFFu) * weight);
+        r[x] = static_cast<uint16_t>(((a >> 16) & 0xFFu) * aboveWeight + ((c >> 16) & 0xFFu) * weight);
+    }
+}
+
+/**
+ * Resamples one blended row to width values of 8 bit; row must hold one
+ * more value past the last column.
+ */
+inline uint32_t resample(const uint16_t *__restrict row, uint32_t column, uint32_t weight) noexcept {
+    return (row[column] * (256 - weight) + row[column + 1] * weight + 32768) >> 16;
+}
+
+PIPELINE_SIMD_CLONES
+void resampleRow(const uint16_t *__restrict row, const uint32_t *__restrict columns, const uint32_t *__restrict weights, uint32_t width,
+                 uint8_t *__restrict out) noexcept {
+    for (std::size_t x{0}; x < width; x++) {
+        out[x] = static_cast<uint8_t>(resample(row, columns[x], weights[x]));
+    }
+}
+
+PIPELINE_SIMD_CLONES
+void resampleRowFloat16(const uint16_t *__restrict row, const uint32_t *__restrict columns, const uint32_t *__restrict weights, uint32_t width,
+                        const uint16_t *__restrict table, uint16_t *__restrict out) noexcept {
+    for (std::size_t x{0}; x < width; x++) {
+        out[x] = table[resample(row, columns[x], weights[x])];
+    }
+}
+
+}  // namespace
+
+TensorWriter::TensorWriter(uint32_t imageWidth, uint32_t imageHeight, const Parameters &parameters)
+    : m_imageWidth{imageWidth}
+    , m_imageHeight{imageHeight}
+    , m_parameters(parameters)
+    , m_uint8Table{}
+    , m_float16Table{} {
+    assert((0 < imageWidth) && (0 < imageHeight) && (0 < parameters.width) && (0 < parameters.height));
+    const float scale{std::min(static_cast<float>(parameters.width) / static_cast<float>(imageWidth),
+                               static_cast<float>(parameters.height) / static_cast<float>(imageHeight))};
+    m_scaledWidth  = std::max(1u, std::min(parameters.width, static_cast<uint32_t>(std::lround(static_cast<float>(imageWidth) * scale))));
+    m_scaledHeight = std::max(1u, std::min(parameters.height, static_cast<uint32_t>(std::lround(static_cast<float>(imageHeight) * scale))));
+    samplePositions(imageWidth, m_scaledWidth, m_columns, m_columnWeights);
+    samplePositions(imageHeight, m_scaledHeight, m_rows, m_rowWeights);
+
+    m_header.version  = TensorHeader::VERSION;
+    m_header.type     = static_cast<uint32_t>(parameters.type);
+    m_header.batch    = 1;
+    m_header.channels = 3;
+    m_header.height   = parameters.height;
+    m_header.width    = parameters.width;
+    m_header.bgr      = parameters.bgr ? 1 : 0;
+    m_header.scale    = scale;
+    m_header.left     = (parameters.width - m_scaledWidth) / 2;
+    m_header.top      = (parameters.height - m_scaledHeight) / 2;
+    for (uint32_t c{0}; c < 3; c++) {
+        // Tensor channel c holds R, G, B or B, G, R.
+        const uint32_t colour{parameters.bgr ? 2 - c : c};
+        m_header.mean[c]   = parameters.mean[colour];
+        m_header.stddev[c] = parameters.stddev[colour];
+        for (uint32_t value{0}; value < 256; value++) {
+            m_uint8Table[c * 256 + value]   = static_cast<uint8_t>(value);
+            m_float16Table[c * 256 + value] = float16Bits((static_cast<float>(value) / 255.0f - m_header.mean[c]) / m_header.stddev[c]);
+        }
+    }
+}
+
+std::size_t TensorWriter::size() const noexcept {
+    const std::size_t elementSize{(TensorType::FLOAT16 == m_parameters.type) ? sizeof(uint16_t) : sizeof(uint8_t)};
+    return TensorHeader::DATA_OFFSET + 3 * static_cast<std::size_t>(m_parameters.width) * m_parameters.height * elementSize;
+}
+
+template <typename T>
+void TensorWriter::pad(T *tensor, const T *table) const noexcept {
+    const std::size_t width{m_parameters.width};
+    const std::size_t planeSize{width * m_parameters.height};
+    for (uint32_t c{0}; c < 3; c++) {
+        T *plane{tensor + c * planeSize};
+        const T value{table[c * 256 + m_parameters.pad]};
+        for (uint32_t y{0}; y < m_parameters.height; y++) {
+            const bool imageRow{(y >= m_header.top) && (y < m_header.top + m_scaledHeight)};
+            for (uint32_t x{0}; x < m_parameters.width; x++) {
+                if (!imageRow || (x < m_header.left) || (x >= m_header.left + m_scaledWidth)) {
+                    plane[y * width + x] = value;
+                }
+            }
+        }
+    }
+}
+
+void TensorWriter::writeRows(const uint32_t *argb, uint8_t *tensor, uint16_t *scratch, uint32_t firstRow, uint32_t lastRow) const noexcept {
+    const bool float16{TensorType::FLOAT16 == m_parameters.type};
+    const std::size_t elementSize{float16 ? sizeof(uint16_t) : sizeof(uint8_t)};
+    const std::size_t width{m_parameters.width};
+    const std::size_t planeSize{width * m_parameters.height};
+    const std::size_t stride{m_imageWidth + 1u};
+    // Tensor channels in memory order of ARGB (B, G, R).
+    const uint32_t channels[3]{m_parameters.bgr ? 0u : 2u, 1u, m_parameters.bgr ? 2u : 0u};
+    uint16_t *blended[3]{scratch, scratch + stride, scratch + 2 * stride};
+    for (uint32_t y{firstRow}; y < lastRow; y++) {
+        const uint32_t *above{argb + static_cast<std::size_t>(m_rows[y]) * m_imageWidth};
+        const uint32_t *below{(0 < m_rowWeights[y]) ? above + m_imageWidth : above};
+        blendRows(above, below, m_rowWeights[y], m_imageWidth, blended[0], blended[1], blended[2]);
+        const std::size_t offset{(m_header.top + y) * width + m_header.left};
+        for (uint32_t c{0}; c < 3; c++) {
+            // The column right of the last one has a weight of 0.
+            blended[c][m_imageWidth] = blended[c][m_imageWidth - 1];
+            uint8_t *plane{tensor + (channels[c] * planeSize + offset) * elementSize};
+            if (float16) {
+                resampleRowFloat16(blended[c], m_columns.data(), m_columnWeights.data(), m_scaledWidth, m_float16Table + channels[c] * 256,
+                                   reinterpret_cast<uint16_t *>(plane));
+            }
+            else {
+                resampleRow(blended[c], m_columns.data(), m_columnWeights.data(), m_scaledWidth, plane);
+            }
+        }
+    }
+}
+
+void TensorWriter::write(const uint8_t *argb, uint8_t *tensor, WorkerPool &workers) {
+    const bool float16{TensorType::FLOAT16 == m_parameters.type};
+    uint8_t *data{tensor + TensorHeader::DATA_OFFSET};
+    if (tensor != m_tensor) {
+        std::memcpy(tensor, &m_header, sizeof(TensorHeader));
+        if (float16) {
+            pad(reinterpret_cast<uint16_t *>(data), m_float16Table);
+        }
+        else {
+            pad(data, m_uint8Table);
+        }
+        m_tensor = tensor;
+    }
+
+    const uint32_t tasks{std::max(1u, std::min(workers.size(), m_scaledHeight))};
+    const std::size_t scratchSize{3 * (m_imageWidth + std::size_t{1})};
+    if (m_scratch.size() < tasks * scratchSize) {
+        m_scratch.resize(tasks * scratchSize);
+    }
+    workers.run(tasks, [&](uint32_t task) {
+        const uint32_t firstRow{m_scaledHeight * task / tasks};
+        const uint32_t lastRow{m_scaledHeight * (task + 1) / tasks};
+        writeRows(reinterpret_cast<const uint32_t *>(argb), data, m_scratch.data() + task * scratchSize, firstRow, lastRow);
+    });
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_TENSORWRITER_H
+#define PIPELINE_TENSORWRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pipeline/tensorHeader.h"
+#include "pipeline/workerPool.h"
+
+/**
+ * Turns ARGB images into the input tensor of a neural network in a single
+ * pass: the image is resized bilinearly to fit the tensor while keeping its
+ * aspect ratio (letterbox), split into planar R, G, and B (or B, G, R), and
+ * normalised, all while each tensor row is written. Each tensor row is made
+ * by blending the two image rows around it into a row per colour, which is
+ * then resampled into its plane. Normalisation and the conversion to float16
+ * go through a table per channel of the 256 possible values.
+ *
+ * The padding and the TensorHeader are only written when the tensor is
+ * given at a new address, i.e., usually once.
+ */
+class TensorWriter {
+   private:
+    TensorWriter(const TensorWriter &) = delete;
+    TensorWriter(TensorWriter &&)      = delete;
+    TensorWriter &operator=(const TensorWriter &) = delete;
+    TensorWriter &operator=(TensorWriter &&) = delete;
+
+   public:
+    struct Parameters {
+        uint32_t width{0};
+        uint32_t height{0};
+        TensorType type{TensorType::UINT8};
+        // Per R, G, and B, for values scaled to [0, 1]; only for float16.
+        float mean[3]{0.0f, 0.0f, 0.0f};
+        float stddev[3]{1.0f, 1.0f, 1.0f};
+        bool bgr{false};
+        // Value of the padding before normalisation.
+        uint8_t pad{114};
+    };
+
+    TensorWriter(uint32_t imageWidth, uint32_t imageHeight, const Parameters &parameters);
+
+    /**
+     * @return Bytes of the shared memory area: header and tensor.
+     */
+    std::size_t size() const noexcept;
+
+    /**
+     * Writes the tensor of an ARGB image, split into parallel tasks on
+     * workers.
+     *
+     * @param argb ARGB image of imageWidth x imageHeight pixels.
+     * @param tensor size() bytes, starting with the TensorHeader.
+     */
+    void write(const uint8_t *argb, uint8_t *tensor, WorkerPool &workers);
+
+   private:
+    // Writes the image rows [firstRow, lastRow) of the tensor; scratch
+    // holds three rows of imageWidth+1 values.
+    void writeRows(const uint32_t *argb, uint8_t *tensor, uint16_t *scratch, uint32_t firstRow, uint32_t lastRow) const noexcept;
+    template <typename T>
+    void pad(T *tensor, const T *table) const noexcept;
+
+   private:
+    const uint32_t m_imageWidth;
+    const uint32_t m_imageHeight;
+    const Parameters m_parameters;
+    TensorHeader m_header{};
+    // Size of the image in the tensor.
+    uint32_t m_scaledWidth{0};
+    uint32_t m_scaledHeight{0};
+    // Source column of every tensor column of the image and the weight of
+    // the column to its right in 1/256; the same for rows.
+    std::vector<uint32_t> m_columns{};
+    std::vector<uint32_t> m_columnWeights{};
+    std::vector<uint32_t> m_rows{};
+    std::vector<uint32_t> m_rowWeights{};
+    // Tensor element of each value per tensor channel.
+    uint8_t m_uint8Table[3 * 256];
+    uint16_t m_float16Table[3 * 256];
+    const uint8_t *m_tensor{nullptr};
+    // Rows of B, G, and R blended from two image rows, per task.
+    std::vector<uint16_t> m_scratch{};
+};
+
+#endif
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline/toneMapper.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace {
+
+/**
+ * Position of coordinate c between the centres of n tiles covering size
+ * pixels: the lower tile and the weight of the upper one in [0, 1].
+ */
+void tilePosition(uint32_t c, uint32_t size, uint32_t n, uint32_t &tile, float &weight) noexcept {
+    const float position{(static_cast<float>(c) + 0.5f) * static_cast<float>(n) / static_cast<float>(size) - 0.5f};
+    const float clamped{std::min(std::max(position, 0.0f), static_cast<float>(n - 1))};
+    tile   = std::min(static_cast<uint32_t>(clamped), n - 1);
+    weight = (tile + 1 < n) ? clamped - static_cast<float>(tile) : 0.0f;
+}
+
+}  // namespace
+
+ToneMapper::ToneMapper(float compression, float referenceExposure, uint32_t tiles, float strength,
+                       uint32_t width, uint32_t height, const WorkerPool &workers)
+    : m_compression{std::max(compression, 0.0f)}
+    , m_referenceExposure{std::max(referenceExposure, 0.0f)}
+    , m_tiles{tiles}
+    , m_strength{std::min(std::max(strength, 0.0f), 1.0f)}
+    , m_width{width}
+    , m_height{height}
+    , m_stripes{workers.size()}
+    , m_lut(1u << LUT_BITS)
+    , m_sums(m_stripes * tiles * tiles)
+    , m_counts(m_stripes * tiles * tiles)
+    , m_gains(tiles * tiles, 1u << GAIN_BITS)
+    , m_columnTile(width)
+    , m_columnWeight(width)
+    , m_spanEnd(tiles) {
+    assert((tiles <= MAX_TILES) && ((0 == tiles) || ((tiles <= width / 8) && (tiles <= height / 8))));
+    buildLut(1.0f);
+    for (uint32_t x{0}; (0 < m_tiles) && (x < m_width); x++) {
+        float weight{0.0f};
+        tilePosition(x, m_width, m_tiles, m_columnTile[x], weight);
+        m_columnWeight[x] = static_cast<uint16_t>(std::lround(weight * (1u << GAIN_BITS)));
+        m_spanEnd[m_columnTile[x]] = x + 1;
+    }
+}
+
+void ToneMapper::update(float exposure) noexcept {
+    if ( (m_referenceExposure > 0.0f) && (exposure > 0.0f) && !(std::fabs(exposure - m_exposure) <= 0.01f * m_exposure) ) {
+        m_exposure = exposure;
+        buildLut(std::min(std::max(m_referenceExposure / exposure, 1.0f / 16.0f), 16.0f));
+    }
+}
+
+void ToneMapper::buildLut(float gain) noexcept {
+    const float last{static_cast<float>(m_lut.size() - 1)};
+    const float normalization{(m_compression > 0.0f) ? 1.0f / std::log1p(m_compression) : 1.0f};
+    for (std::size_t i{0}; i < m_lut.size(); i++) {
+        const float x{gain * static_cast<float>(i) / last};
+        const float y{(m_compression > 0.0f) ? std::log1p(m_compression * x) * normalization : x};
+        m_lut[i] = static_cast<uint8_t>(std::lround(255.0f * std::min(y, 1.0f)));
+    }
+}
+
+void ToneMapper::measure(const uint16_t *samples, uint32_t firstRow, uint32_t lastRow, uint32_t stripe) noexcept {
+    for (uint32_t y{(firstRow + 7) & ~7u}; y + 1 < lastRow; y += 8) {
+        const uint16_t *row0{samples + static_cast<std::size_t>(y) * m_width};
+        measureRows(row0, row0 + m_width, y, stripe);
+    }
+}
+
+void ToneMapper::measureRows(const uint16_t *row0, const uint16_t *row1, uint32_t y, uint32_t stripe) noexcept {
+    assert(stripe < m_stripes);
+    uint64_t *sums{m_sums.data() + stripe * m_tiles * m_tiles};
+    uint32_t *counts{m_counts.data() + stripe * m_tiles * m_tiles};
+    const uint32_t tileRow{std::min(y * m_tiles / m_height, m_tiles - 1) * m_tiles};
+    for (uint32_t x{0}; x + 1 < m_width; x += 8) {
+        const uint32_t tile{tileRow + std::min(x * m_tiles / m_width, m_tiles - 1)};
+        sums[tile] += static_cast<uint32_t>(row0[x]) + row0[x + 1] + row1[x] + row1[x + 1];
+        counts[tile]++;
+    }
+}
+
+void ToneMapper::finishMeasuring() noexcept {
+    const uint32_t tiles{m_tiles * m_tiles};
+    const uint32_t stripes{m_stripes};
+    std::vector<double> means(tiles, 0.0);
+    double frameSum{0.0};
+    double frameCount{0.0};
+    for (uint32_t t{0}; t < tiles; t++) {
+        uint64_t sum{0};
+        uint64_t count{0};
+        for (uint32_t s{0}; s < stripes; s++) {
+            sum += m_sums[s * tiles + t];
+            count += m_counts[s * tiles + t];
+            m_sums[s * tiles + t]   = 0;
+            m_counts[s * tiles + t] = 0;
+        }
+        means[t] = (0 < count) ? static_cast<double>(sum) / static_cast<double>(count) : 0.0;
+        frameSum += static_cast<double>(sum);
+        frameCount += static_cast<double>(count);
+    }
+    const double frameMean{(frameCount > 0.0) ? frameSum / frameCount : 0.0};
+    for (uint32_t t{0}; t < tiles; t++) {
+        const double gain{((means[t] > 0.0) && (frameMean > 0.0)) ? std::pow(frameMean / means[t], static_cast<double>(m_strength)) : 1.0};
+        m_gains[t] = static_cast<uint16_t>(std::lround(std::min(std::max(gain, 0.25), 4.0) * (1u << GAIN_BITS)));
+    }
+}
+
+void ToneMapper::gainRow(uint32_t y, uint16_t *gains) const noexcept {
+    if (0 == m_tiles) {
+        std::fill(gains, gains + m_width, static_cast<uint16_t>(1u << GAIN_BITS));
+        return;
+    }
+    uint32_t tileRow{0};
+    float weight{0.0f};
+    tilePosition(y, m_height, m_tiles, tileRow, weight);
+    const uint32_t w1{static_cast<uint32_t>(std::lround(weight * (1u << GAIN_BITS)))};
+    const uint32_t w0{(1u << GAIN_BITS) - w1};
+    const uint16_t *upper{m_gains.data() + tileRow * m_tiles};
+    const uint16_t *lower{(tileRow + 1 < m_tiles) ? upper + m_tiles : upper};
+
+    // Blend the two tile rows first, then interpolate along the row.
+    uint32_t blended[MAX_TILES + 1];
+    for (uint32_t t{0}; t < m_tiles; t++) {
+        blended[t] = (upper[t] * w0 + lower[t] * w1) >> GAIN_BITS;
+    }
+    blended[m_tiles] = blended[m_tiles - 1];
+    // Columns between the same two tile centres form a span, which keeps
+    // the inner loop free of table lookups.
+    for (uint32_t x{0}; x < m_width;) {
+        const uint32_t t{m_columnTile[x]};
+        const uint32_t a{blended[t]};
+        const uint32_t b{blended[t + 1]};
+        const std::size_t end{m_spanEnd[t]};
+        for (std::size_t i{x}; i < end; i++) {
+            gains[i] = static_cast<uint16_t>((a * ((1u << GAIN_BITS) - m_columnWeight[i]) + b * m_columnWeight[i]) >> GAIN_BITS);
+        }
+        x = static_cast<uint32_t>(end);
+    }
+}
+
+void ToneMapper::map(const uint16_t *row, uint32_t y, uint8_t *mapped, uint16_t *scratch) const noexcept {
+    const uint8_t *__restrict lut{m_lut.data()};
+    const uint16_t *__restrict samples{row};
+    uint8_t *__restrict out{mapped};
+    if (0 < m_tiles) {
+        // Scale into the scratch row first so that the table lookups, which
+        // do not vectorize, run in a loop of their own.
+        uint16_t *__restrict scaled{scratch};
+        gainRow(y, scaled);
+        for (std::size_t x{0}; x < m_width; x++) {
+            scaled[x] = static_cast<uint16_t>(std::min((static_cast<uint32_t>(samples[x]) * scaled[x]) >> GAIN_BITS, 0xFFFFu));
+        }
+        samples = scaled;
+    }
+    for (std::size_t x{0}; x < m_width; x++) {
+        out[x] = lut[samples[x] >> (16 - LUT_BITS)];
+    }
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_TONEMAPPER_H
+#define PIPELINE_TONEMAPPER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pipeline/workerPool.h"
+
+/**
+ * Maps linear 16 bit samples to 8 bit. It works on the samples of the
+ * frame before demosaicing, which takes one table lookup per sample rather
+ * than one per colour of every pixel.
+ *
+ * The global curve is a lookup table indexed by the upper 12 bits of a
+ * sample, out = log(1 + c*g*x) / log(1 + c) for x in [0, 1], where c is the
+ * compression (0 is linear) and g = referenceExposure / exposure scales the
+ * frame to the reference exposure (1 without one). The table depends on
+ * the exposure only and is rebuilt by update() when that changes.
+ *
+ * The optional local operator splits the frame into tiles x tiles tiles
+ * and brightens dark tiles and darkens bright ones by
+ * gain = (frame mean / tile mean)^strength, limited to [1/4, 4]. The tile
+ * means are measured on the current frame before it is mapped; the gains
+ * are interpolated bilinearly between tile centres.
+ */
+class ToneMapper {
+   private:
+    ToneMapper(const ToneMapper &) = delete;
+    ToneMapper(ToneMapper &&)      = delete;
+    ToneMapper &operator=(const ToneMapper &) = delete;
+    ToneMapper &operator=(ToneMapper &&) = delete;
+
+   public:
+    static const uint32_t LUT_BITS{12};
+    static const uint32_t MAX_TILES{64};
+    // Gains are fixed point with GAIN_BITS fractional bits.
+    static const uint32_t GAIN_BITS{8};
+
+    /**
+     * @param compression Strength of the global curve; 0 is linear.
+     * @param referenceExposure Exposure in seconds that frames are scaled
+     *        to, or 0 to leave them as they are.
+     * @param tiles Number of tiles per direction for the local operator, or
+     *        0; at most MAX_TILES and at most width/8 and height/8.
+     * @param strength Strength of the local operator in [0, 1].
+     * @param width Width of the frames.
+     * @param height Height of the frames.
+     * @param workers Pool of the converter that measures the frames; it
+     *        measures in at most one stripe per worker.
+     */
+    ToneMapper(float compression, float referenceExposure, uint32_t tiles, float strength,
+               uint32_t width, uint32_t height, const WorkerPool &workers);
+
+    /**
+     * Rebuilds the lookup table if the exposure changed by more than 1%.
+     *
+     * @param exposure Exposure of the next frame in seconds.
+     */
+    void update(float exposure) noexcept;
+
+    const uint8_t *lut() const noexcept {
+        return m_lut.data();
+    }
+
+    bool local() const noexcept {
+        return 0 < m_tiles;
+    }
+
+    /**
+     * @return Number of stripes that can be measured in parallel.
+     */
+    uint32_t stripes() const noexcept {
+        return m_stripes;
+    }
+
+    /**
+     * Adds the samples of rows [firstRow, lastRow) of a frame to the tile
+     * statistics of the given stripe; only every 8th 2x2 cell is used.
+     */
+    void measure(const uint16_t *samples, uint32_t firstRow, uint32_t lastRow, uint32_t stripe) noexcept;
+
+    /**
+     * Adds rows y and y + 1 to the tile statistics of the given stripe, for
+     * callers that prepare the rows one by one. measure() uses the rows at
+     * every multiple of 8 for y.
+     */
+    void measureRows(const uint16_t *row0, const uint16_t *row1, uint32_t y, uint32_t stripe) noexcept;
+
+    /**
+     * Turns the statistics of all stripes into tile gains and clears them.
+     */
+    void finishMeasuring() noexcept;
+
+    /**
+     * @param y Row.
+     * @param gains Receives width gains.
+     */
+    void gainRow(uint32_t y, uint16_t *gains) const noexcept;
+
+    /**
+     * Maps row y of a frame to 8 bit.
+     *
+     * @param scratch Room for width values.
+     */
+    void map(const uint16_t *row, uint32_t y, uint8_t *mapped, uint16_t *scratch) const noexcept;
+
+   private:
+    void buildLut(float gain) noexcept;
+
+   private:
+    const float m_compression;
+    const float m_referenceExposure;
+    const uint32_t m_tiles;
+    const float m_strength;
+    const uint32_t m_width;
+    const uint32_t m_height;
+    const uint32_t m_stripes;
+    float m_exposure{0.0f};
+    std::vector<uint8_t> m_lut;
+    // Per stripe sums and counts of all tiles.
+    std::vector<uint64_t> m_sums;
+    std::vector<uint32_t> m_counts;
+    // Gains of all tiles.
+    std::vector<uint16_t> m_gains;
+    // For every column: the tile to its left (or itself) and the
+    // weight of the tile to its right.
+    std::vector<uint32_t> m_columnTile;
+    std::vector<uint16_t> m_columnWeight;
+    // Column after the last one whose left tile is a given tile.
+    std::vector<uint32_t> m_spanEnd;
+};
+
+#endif
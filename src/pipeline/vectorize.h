@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_VECTORIZE_H
+#define PIPELINE_VECTORIZE_H
+
+/**
+ * The pixel kernels are plain loops over unsigned 8 and 16 bit arrays that
+ * the compiler vectorizes (the kernel sources are built with -O3). On
+ * x86_64, entry points marked with PIPELINE_SIMD_CLONES are additionally
+ * compiled for AVX2 and SSE4.1 and the best version for the running CPU is
+ * picked at load time; the helpers they call are flattened into them so
+ * that those are compiled for the same target. ARM builds use NEON, which
+ * is always available on aarch64 and enabled with -mfpu=neon on armhf.
+ */
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+    #define PIPELINE_SIMD_CLONES __attribute__((target_clones("avx2", "sse4.1", "default"), flatten))
+#else
+    #define PIPELINE_SIMD_CLONES
+#endif
+
+#endif
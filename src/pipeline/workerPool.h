@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_WORKERPOOL_H
+#define PIPELINE_WORKERPOOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Persistent threads that run the tasks of a job in parallel. The thread
+ * calling run() works on the job as well, so a pool of size n starts n-1
+ * threads; a pool of size 1 runs everything on the caller.
+ */
+class WorkerPool {
+   private:
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool(WorkerPool &&)      = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+    WorkerPool &operator=(WorkerPool &&) = delete;
+
+   public:
+    explicit WorkerPool(uint32_t size) {
+        for (uint32_t i{1}; i < size; i++) {
+            m_threads.emplace_back(&WorkerPool::work, this);
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lck(m_mutex);
+            m_stop = true;
+        }
+        m_jobAvailable.notify_all();
+        for (auto &t : m_threads) {
+            t.join();
+        }
+    }
+
+    uint32_t size() const noexcept {
+        return static_cast<uint32_t>(m_threads.size()) + 1;
+    }
+
+    /**
+     * Runs task(0) to task(count-1) and returns when all of them are done.
+     * run() must not be called concurrently.
+     */
+    void run(uint32_t count, const std::function<void(uint32_t)> &task) {
+        {
+            std::lock_guard<std::mutex> lck(m_mutex);
+            m_task    = &task;
+            m_count   = count;
+            m_next    = 0;
+            m_pending = count;
+            m_generation++;
+        }
+        m_jobAvailable.notify_all();
+
+        std::unique_lock<std::mutex> lck(m_mutex);
+        execute(lck);
+        m_jobDone.wait(lck, [this]() { return 0 == m_pending; });
+        m_task = nullptr;
+    }
+
+   private:
+    // Takes tasks of the current job until none is left; m_mutex is held
+    // except while a task runs.
+    void execute(std::unique_lock<std::mutex> &lck) {
+        while (m_next < m_count) {
+            const uint32_t index{m_next++};
+            const std::function<void(uint32_t)> &task{*m_task};
+            lck.unlock();
+            task(index);
+            lck.lock();
+            if (0 == --m_pending) {
+                m_jobDone.notify_all();
+            }
+        }
+    }
+
+    void work() {
+        uint64_t generation{0};
+        std::unique_lock<std::mutex> lck(m_mutex);
+        while (true) {
+            m_jobAvailable.wait(lck, [this, &generation]() { return m_stop || (generation != m_generation); });
+            if (m_stop) {
+                return;
+            }
+            generation = m_generation;
+            execute(lck);
+        }
+    }
+
+   private:
+    std::vector<std::thread> m_threads{};
+    std::mutex m_mutex{};
+    std::condition_variable m_jobAvailable{};
+    std::condition_variable m_jobDone{};
+    const std::function<void(uint32_t)> *m_task{nullptr};
+    uint32_t m_count{0};
+    uint32_t m_next{0};
+    uint32_t m_pending{0};
+    uint64_t m_generation{0};
+    bool m_stop{false};
+};
+
+#endif
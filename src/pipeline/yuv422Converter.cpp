@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline/yuv422Converter.h"
+
+#include <libyuv.h>
+
+#include <cassert>
+#include <cstddef>
+
+Yuv422Converter::Yuv422Converter(uint32_t width, uint32_t height, WorkerPool &workers)
+    : FrameConverter{width, height, workers} {
+    assert((2 <= width) && (0 == width % 2));
+    assert((2 <= height) && (0 == height % 2));
+}
+
+void Yuv422Converter::convert(const uint8_t *uyvy, uint8_t *y, uint8_t *u, uint8_t *v, uint8_t *argb) {
+    const int width{static_cast<int>(outputWidth())};
+    forEachOutputStripe([&](uint32_t, uint32_t firstRow, uint32_t lastRow) {
+        const int rows{static_cast<int>(lastRow - firstRow)};
+        const uint8_t *stripe{uyvy + static_cast<std::size_t>(firstRow) * width * 2};
+        libyuv::UYVYToI420(stripe, width * 2,
+                           y + static_cast<std::size_t>(firstRow) * width, width,
+                           u + static_cast<std::size_t>(firstRow / 2) * (width / 2), width / 2,
+                           v + static_cast<std::size_t>(firstRow / 2) * (width / 2), width / 2,
+                           width, rows);
+        // NV12 and GRAY8 from the I420 stripe while it is still in cache.
+        if (nullptr != nv12()) {
+            const std::size_t size{static_cast<std::size_t>(width) * outputHeight()};
+            libyuv::CopyPlane(y + static_cast<std::size_t>(firstRow) * width, width,
+                              nv12() + static_cast<std::size_t>(firstRow) * width, width,
+                              width, rows);
+            libyuv::MergeUVPlane(u + static_cast<std::size_t>(firstRow / 2) * (width / 2), width / 2,
+                                 v + static_cast<std::size_t>(firstRow / 2) * (width / 2), width / 2,
+                                 nv12() + size + static_cast<std::size_t>(firstRow / 2) * width, width,
+                                 width / 2, rows / 2);
+        }
+        if (nullptr != gray()) {
+            libyuv::CopyPlane(y + static_cast<std::size_t>(firstRow) * width, width,
+                              gray() + static_cast<std::size_t>(firstRow) * width, width,
+                              width, rows);
+        }
+        if (nullptr != argb) {
+            libyuv::UYVYToARGB(stripe, width * 2,
+                               argb + static_cast<std::size_t>(firstRow) * width * 4, width * 4,
+                               width, rows);
+        }
+    });
+}
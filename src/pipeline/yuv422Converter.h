@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_YUV422CONVERTER_H
+#define PIPELINE_YUV422CONVERTER_H
+
+#include <cstdint>
+
+#include "pipeline/frameConverter.h"
+#include "pipeline/workerPool.h"
+
+/**
+ * Converts packed YUV 4:2:2 frames as debayered on the camera (UYVY, i.e.,
+ * U0 Y0 V0 Y1 per pair of pixels) into I420 and ARGB. Y is taken as it is,
+ * U and V of two rows are averaged; ARGB is computed from the full 4:2:2
+ * chroma. Each stripe is converted by libyuv's vectorized row functions
+ * while it is still in cache. The camera's YUV is taken to be BT.601 with
+ * limited range, which is also what libyuv assumes for ARGB.
+ *
+ * Width and height must be even.
+ */
+class Yuv422Converter : public FrameConverter {
+   private:
+    Yuv422Converter(const Yuv422Converter &) = delete;
+    Yuv422Converter(Yuv422Converter &&)      = delete;
+    Yuv422Converter &operator=(const Yuv422Converter &) = delete;
+    Yuv422Converter &operator=(Yuv422Converter &&) = delete;
+
+   public:
+    Yuv422Converter(uint32_t width, uint32_t height, WorkerPool &workers);
+
+    void convert(const uint8_t *uyvy, uint8_t *y, uint8_t *u, uint8_t *v, uint8_t *argb) override;
+};
+
+#endif
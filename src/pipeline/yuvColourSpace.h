@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PIPELINE_YUVCOLOURSPACE_H
+#define PIPELINE_YUVCOLOURSPACE_H
+
+#include <cstdint>
+
+/**
+ * Matrix from RGB to YUV of the published I420 images.
+ */
+enum class YuvMatrix : uint8_t {
+    BT601 = 0,
+    BT709 = 1,
+};
+
+/**
+ * LIMITED puts Y into [16, 235] and U and V into [16, 240]; FULL uses
+ * [0, 255] for all three.
+ */
+enum class YuvRange : uint8_t {
+    LIMITED = 0,
+    FULL    = 1,
+};
+
+/**
+ * Fixed-point coefficients of the conversion from 8 bit RGB to YUV with
+ * YUV_BITS fractional bits, computed at compile time:
+ *
+ *   Y = Y_OFFSET + YR*R + YG*G + YB*B
+ *   U = 128 + UR*R + UG*G + UB*B
+ *   V = 128 + VR*R + VG*G + VB*B
+ *
+ * The green coefficients are derived from the rounded red and blue ones so
+ * that white maps exactly to the top of the luma range and grey has no
+ * chroma.
+ */
+static const uint32_t YUV_BITS{16};
+
+constexpr int32_t yuvFixed(double value) noexcept {
+    return static_cast<int32_t>(value * (1 << YUV_BITS) + ((value < 0.0) ? -0.5 : 0.5));
+}
+
+template <YuvMatrix MATRIX, YuvRange RANGE>
+struct YuvCoefficients {
+    static constexpr double KR{(YuvMatrix::BT709 == MATRIX) ? 0.2126 : 0.299};
+    static constexpr double KB{(YuvMatrix::BT709 == MATRIX) ? 0.0722 : 0.114};
+    static constexpr double Y_SCALE{(YuvRange::FULL == RANGE) ? 1.0 : 219.0 / 255.0};
+    static constexpr double C_SCALE{(YuvRange::FULL == RANGE) ? 1.0 : 224.0 / 255.0};
+
+    static constexpr int32_t Y_OFFSET{(YuvRange::FULL == RANGE) ? 0 : 16};
+    static constexpr int32_t YR{yuvFixed(Y_SCALE * KR)};
+    static constexpr int32_t YB{yuvFixed(Y_SCALE * KB)};
+    static constexpr int32_t YG{yuvFixed(Y_SCALE) - YR - YB};
+    static constexpr int32_t UB{yuvFixed(C_SCALE / 2.0)};
+    static constexpr int32_t UR{yuvFixed(-C_SCALE * KR / (2.0 * (1.0 - KB)))};
+    static constexpr int32_t UG{-UB - UR};
+    static constexpr int32_t VR{yuvFixed(C_SCALE / 2.0)};
+    static constexpr int32_t VB{yuvFixed(-C_SCALE * KB / (2.0 * (1.0 - KR)))};
+    static constexpr int32_t VG{-VR - VB};
+};
+
+#endif
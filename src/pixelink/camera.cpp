@@ -7,6 +7,8 @@
 #include "camera.h"
 
 #include <unistd.h>
+#include <chrono>
+#include <cstring>
 #include <vector>
 #include <memory>
 
@@ -41,6 +43,10 @@ PxLCamera::PxLCamera (ULONG serialNum)
 , m_hCamera(NULL)
 , m_streamState(STOP_STREAM)
 , m_previewState(STOP_PREVIEW)
+, m_framePoolSize(4)
+, m_framePool()
+, m_discardFrame()
+, m_frameHandler()
 {
 	PXL_RETURN_CODE rc = ApiSuccess;
 	char  title[40];
@@ -80,6 +86,8 @@ PxLCamera::PxLCamera (ULONG serialNum)
 
 PxLCamera::~PxLCamera()
 {
+    // Waits for a callback still running on the SDK's thread.
+    setFrameHandler(FrameHandler());
     PxLUninitialize (m_hCamera);
 }
 
@@ -88,6 +96,9 @@ PXL_RETURN_CODE PxLCamera::play()
 	PXL_RETURN_CODE rc = ApiSuccess;
 	ULONG currentStreamState = m_streamState;
 
+	// The frame callback may fire as soon as the stream runs.
+	allocateFramePool();
+
 	// Start the camera stream, if necessary
 	if (START_STREAM != currentStreamState)
 	{
@@ -379,6 +390,10 @@ PXL_RETURN_CODE PxLCamera::getRoiRange (PXL_ROI* minRoi, PXL_ROI* maxRoi)
         NULL == pFeatureInfo->pFeatures->pParams ||
         4 < pFeatureInfo->pFeatures->uNumberOfParameters) return ApiInvalidParameterError;
 
+    minRoi->m_left = (int)pFeatureInfo->pFeatures->pParams[FEATURE_ROI_PARAM_LEFT].fMinValue;
+    maxRoi->m_left = (int)pFeatureInfo->pFeatures->pParams[FEATURE_ROI_PARAM_LEFT].fMaxValue;
+    minRoi->m_top = (int)pFeatureInfo->pFeatures->pParams[FEATURE_ROI_PARAM_TOP].fMinValue;
+    maxRoi->m_top = (int)pFeatureInfo->pFeatures->pParams[FEATURE_ROI_PARAM_TOP].fMaxValue;
     minRoi->m_width = (int)pFeatureInfo->pFeatures->pParams[FEATURE_ROI_PARAM_WIDTH].fMinValue;
     maxRoi->m_width = (int)pFeatureInfo->pFeatures->pParams[FEATURE_ROI_PARAM_WIDTH].fMaxValue;
     minRoi->m_height = (int)pFeatureInfo->pFeatures->pParams[FEATURE_ROI_PARAM_HEIGHT].fMinValue;
@@ -397,6 +412,8 @@ PXL_RETURN_CODE PxLCamera::getRoiValue (PXL_ROI* roi)
     rc = PxLGetFeature (m_hCamera, FEATURE_ROI, &flags, &numParams, featureValue);
     if (!API_SUCCESS(rc)) return rc;
 
+    roi->m_left = featureValue[FEATURE_ROI_PARAM_LEFT];
+    roi->m_top = featureValue[FEATURE_ROI_PARAM_TOP];
     roi->m_width = featureValue[FEATURE_ROI_PARAM_WIDTH];
     roi->m_height = featureValue[FEATURE_ROI_PARAM_HEIGHT];
 
@@ -413,15 +430,28 @@ PXL_RETURN_CODE PxLCamera::setRoiValue (PXL_ROI &roi)
 
     featureValue[FEATURE_ROI_PARAM_WIDTH] = (float)roi.m_width;
     featureValue[FEATURE_ROI_PARAM_HEIGHT] = (float)roi.m_height;
-    // We will always center our ROI...
+    // Center the ROI unless an origin is given...
     PXL_ROI min,max;
     int roiOriginX, roiOriginY;
 
     rc = getRoiRange (&min, &max);
     if (!API_SUCCESS(rc)) return rc;
 
-    roiOriginX = (((max.m_width - roi.m_width) / 2) / min.m_width) * min.m_width;
-    roiOriginY = (((max.m_height - roi.m_height) / 2) / min.m_height) * min.m_height;
+    if (roi.m_width > max.m_width || roi.m_height > max.m_height) return ApiInvalidParameterError;
+    // A given origin must leave room for the ROI on the sensor.
+    if (roi.m_left > max.m_width - roi.m_width || roi.m_top > max.m_height - roi.m_height) return ApiInvalidParameterError;
+
+    if (roi.m_left < 0) {
+        roiOriginX = (((max.m_width - roi.m_width) / 2) / min.m_width) * min.m_width;
+    } else {
+        // ... and keep it on even columns/rows, so the Bayer phase does not change.
+        roiOriginX = roi.m_left & ~1;
+    }
+    if (roi.m_top < 0) {
+        roiOriginY = (((max.m_height - roi.m_height) / 2) / min.m_height) * min.m_height;
+    } else {
+        roiOriginY = roi.m_top & ~1;
+    }
     featureValue[FEATURE_ROI_PARAM_LEFT] = (float)roiOriginX;
     featureValue[FEATURE_ROI_PARAM_TOP] = (float)roiOriginY;
 
@@ -470,6 +500,26 @@ uint32_t PxLCamera::getImageSize ()
     return (U32) (numPixels * pixelSize (pixelFormat));
 }
 
+PXL_RETURN_CODE PxLCamera::getImageDimensions (uint32_t* width, uint32_t* height)
+{
+    PXL_RETURN_CODE rc = ApiSuccess;
+    PXL_ROI roi;
+    float mode;
+    float value;
+
+    rc = getRoiValue (&roi);
+    if (!API_SUCCESS(rc)) return rc;
+    rc = getPixelAddressValue (&mode, &value);
+    if (!API_SUCCESS(rc)) return rc;
+
+    // Same reduction as in getImageSize, so that both always agree.
+    U32 pixelAddressingValue = (U32)value;
+    if (0 == pixelAddressingValue) return ApiInvalidParameterError;
+    *width = (U32)roi.m_width / pixelAddressingValue;
+    *height = (U32)roi.m_height / pixelAddressingValue;
+
+    return ApiSuccess;
+}
 
 PXL_RETURN_CODE PxLCamera::getWhiteBalanceRange (float* min, float* max)
 {
@@ -646,7 +696,7 @@ PXL_RETURN_CODE PxLCamera::getFlip (bool* horizontal, bool* vertical)
     if (!API_SUCCESS(rc)) return rc;
 
     *horizontal = featureValues[0] != 0.0f;
-    *vertical   = featureValues[0] != 0.0f;
+    *vertical   = featureValues[1] != 0.0f;
 
     return ApiSuccess;
 }
@@ -753,10 +803,99 @@ PXL_RETURN_CODE PxLCamera::getNextFrame (uint32_t rawImageSize, void*pFrame)
     return rc;
 }
 
+void PxLCamera::setFramePoolSize (uint32_t count)
+{
+    assert(0 < count);
+    m_framePoolSize = count;
+    if (streaming()) allocateFramePool();
+}
+
+PXL_RETURN_CODE PxLCamera::acquire (PxLFrame* pFrame)
+{
+    assert(0 != m_hCamera);
+    assert(pFrame);
+    assert (streaming());
+    assert (m_framePool);
+
+    *pFrame = atomic_load(&m_framePool)->borrow();
+    if (!pFrame->valid())
+    {
+        FRAME_DESC frameDesc;
+        PXL_RETURN_CODE rc = getNextFrame ((ULONG)m_discardFrame.size(), &m_discardFrame[0], &frameDesc);
+        if (!API_SUCCESS(rc)) return rc;
+        return FramePoolExhausted;
+    }
+
+    PXL_RETURN_CODE rc = getNextFrame (pFrame->size(), pFrame->data(), pFrame->desc());
+    if (!API_SUCCESS(rc))
+    {
+        pFrame->release();
+        return rc;
+    }
+    pFrame->setArrival(chrono::system_clock::now());
+
+    return rc;
+}
+
+PXL_RETURN_CODE PxLCamera::setFrameHandler (FrameHandler handler)
+{
+    PXL_RETURN_CODE rc = ApiSuccess;
+    assert(0 != m_hCamera);
+
+    // Unregister first so that no new callbacks start; a callback already running on the
+    // SDK's thread holds the mutex until its handler returns.
+    rc = PxLSetCallback (m_hCamera, CALLBACK_FRAME, NULL, NULL);
+    if (!API_SUCCESS(rc)) return rc;
+
+    {
+        std::lock_guard<std::mutex> lock(m_frameHandlerMutex);
+        m_frameHandler = std::move(handler);
+        if (!m_frameHandler) return ApiSuccess;
+    }
+
+    return PxLSetCallback (m_hCamera, CALLBACK_FRAME, this, &PxLCamera::frameCallback);
+}
+
 /***********************************************************************
  *  Private members
  */
 
+void PxLCamera::allocateFramePool ()
+{
+    // Frames still borrowed from a previous pool keep that pool alive until they are released.
+    const uint32_t bufferSize = getImageSize();
+    if (m_framePool && m_framePool->bufferSize() == bufferSize && m_framePool->count() == m_framePoolSize) return;
+
+    m_discardFrame.resize(bufferSize);
+    atomic_store(&m_framePool, PxLFramePool::create(m_framePoolSize, bufferSize));
+}
+
+U32 PxLCamera::frameCallback (HANDLE /*hCamera*/, LPVOID pFrameData, U32 /*dataFormat*/, FRAME_DESC const* pFrameDesc, LPVOID context)
+{
+    PxLCamera* pCamera = static_cast<PxLCamera*>(context);
+    const chrono::system_clock::time_point arrival = chrono::system_clock::now();
+
+    std::lock_guard<std::mutex> lock(pCamera->m_frameHandlerMutex);
+    if (!pCamera->m_frameHandler) return ApiSuccess;
+
+    shared_ptr<PxLFramePool> pool = atomic_load(&pCamera->m_framePool);
+    if (!pool) return ApiSuccess;
+    PxLFrame frame = pool->borrow();
+    if (!frame.valid())
+    {
+        pCamera->m_frameHandler(PxLFrame());
+        return ApiSuccess;
+    }
+
+    // The SDK owns pFrameData only for the duration of this call.
+    memcpy (frame.data(), pFrameData, frame.size());
+    *frame.desc() = *pFrameDesc;
+    frame.setArrival(arrival);
+    pCamera->m_frameHandler(std::move(frame));
+
+    return ApiSuccess;
+}
+
 PXL_RETURN_CODE PxLCamera::getFlags (ULONG feature, ULONG *flags)
 {
     PXL_RETURN_CODE rc = ApiSuccess;
@@ -10,11 +10,16 @@
 #if !defined(PIXELINK_CAMERA_H)
 #define PIXELINK_CAMERA_H
 #include "roi.h"
+#include "frame.h"
 
 #include <PixeLINKApi.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <assert.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 //
 // A very simple PixeLINKApi exception handler
@@ -43,6 +48,9 @@ public:
     PxLCamera (ULONG serialNum);
     // Destructor
     ~PxLCamera();
+    // owns the camera handle and the frame pool
+    PxLCamera (const PxLCamera&) = delete;
+    PxLCamera& operator= (const PxLCamera&) = delete;
 
     ULONG serialNum();
 
@@ -75,6 +83,8 @@ public:
     PXL_RETURN_CODE getRoiValue (PXL_ROI* roi);
     PXL_RETURN_CODE setRoiValue (PXL_ROI &roi);
     uint32_t getImageSize ();
+    // width and height of a frame in pixels, i.e., the ROI reduced by pixel addressing
+    PXL_RETURN_CODE getImageDimensions (uint32_t* width, uint32_t* height);
     PXL_RETURN_CODE setGammaValues (float gamma);
     PXL_RETURN_CODE setGainValues (float gain);
     PXL_RETURN_CODE setSaturationValues (float saturation);
@@ -88,6 +98,25 @@ public:
     PXL_RETURN_CODE captureImage (const char* fileName, ULONG imageType);
     PXL_RETURN_CODE getNextFrame (ULONG bufferSize, void*pFrame);
 
+    // pooled frame services; the pool is (re)allocated from getImageSize() when the stream starts
+    void setFramePoolSize (uint32_t count);
+    // Returned by acquire() when every pool buffer is still borrowed; not an SDK code, but
+    // like the SDK's errors it fails API_SUCCESS().
+    static const PXL_RETURN_CODE FramePoolExhausted = (PXL_RETURN_CODE)0x8FFF0001;
+    // On success, *pFrame holds the next frame and its FRAME_DESC. If every pool buffer is
+    // still borrowed, the frame is drained from the camera and FramePoolExhausted is returned.
+    // On any failure, *pFrame is left invalid.
+    PXL_RETURN_CODE acquire (PxLFrame* pFrame);
+    // Callback driven alternative to acquire(): every frame the SDK delivers is copied into
+    // a pool buffer and passed to the handler on the SDK's callback thread. This saves the
+    // wake-up of a thread blocked in acquire(), but not a copy: the SDK's buffer is only
+    // valid during the callback, while frames are converted on another thread. Frames arriving
+    // while the pool is exhausted are dropped and reported as an invalid frame. An empty
+    // handler disables the callback; once this returns, the previous handler is no longer
+    // running and will not be called again.
+    typedef std::function<void (PxLFrame&&)> FrameHandler;
+    PXL_RETURN_CODE setFrameHandler (FrameHandler handler);
+
 private:
     PXL_RETURN_CODE DisableTriggering();
     PXL_RETURN_CODE SetTriggering(int mode, int triggerType, int polarity, float delay, float param);
@@ -96,6 +125,8 @@ private:
     ULONG  imageSize ();
     PXL_RETURN_CODE getNextFrame (ULONG bufferSize, void*pFrame, FRAME_DESC* pFrameDesc);
     float  pixelSize (ULONG pixelFormat);
+    void   allocateFramePool ();
+    static U32 frameCallback (HANDLE hCamera, LPVOID pFrameData, U32 dataFormat, FRAME_DESC const* pFrameDesc, LPVOID context);
 
     ULONG  m_serialNum; // serial number of our camera
 
@@ -105,6 +136,12 @@ private:
     ULONG  m_previewState;
 
     HWND   m_previewHandle;
+
+    uint32_t m_framePoolSize;
+    std::shared_ptr<PxLFramePool> m_framePool;
+    std::vector<uint8_t> m_discardFrame; // drains frames while the pool is exhausted
+    std::mutex   m_frameHandlerMutex; // held by frameCallback while the handler runs
+    FrameHandler m_frameHandler;
 };
 
 inline ULONG PxLCamera::serialNum()
@@ -173,8 +210,8 @@ class PxLInterruptStream
 public:
     PxLInterruptStream(PxLCamera* pCam, ULONG newState)
     : m_pCam(pCam)
+    , m_oldState(pCam->m_streamState)
     {
-        m_oldState = pCam->m_streamState;
         if (newState != m_oldState)
         {
             switch (newState)
@@ -209,6 +246,8 @@ public:
             }
         }
     }
+    PxLInterruptStream(const PxLInterruptStream&) = delete;
+    PxLInterruptStream& operator=(const PxLInterruptStream&) = delete;
 private:
     PxLCamera*   m_pCam;
     U32          m_oldState;
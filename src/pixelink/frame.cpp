@@ -0,0 +1,99 @@
+/***************************************************************************
+ *
+ *     File: frame.cpp
+ *
+ *     Description: Move-only frame handles backed by a pre-allocated buffer pool
+ */
+#include "frame.h"
+
+#include <utility>
+
+using namespace std;
+
+/***********************************************************************
+ *  PxLFrame
+ */
+
+PxLFrame::PxLFrame()
+: m_pool()
+, m_index(0)
+{
+}
+
+PxLFrame::PxLFrame(const shared_ptr<PxLFramePool>& pool, uint32_t index)
+: m_pool(pool)
+, m_index(index)
+{
+}
+
+PxLFrame::PxLFrame(PxLFrame&& other) noexcept
+: m_pool(std::move(other.m_pool))
+, m_index(other.m_index)
+{
+    other.m_pool.reset();
+}
+
+PxLFrame& PxLFrame::operator=(PxLFrame&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        m_pool = std::move(other.m_pool);
+        m_index = other.m_index;
+        other.m_pool.reset();
+    }
+    return *this;
+}
+
+PxLFrame::~PxLFrame()
+{
+    release();
+}
+
+void PxLFrame::release()
+{
+    if (m_pool)
+    {
+        m_pool->giveBack(m_index);
+        m_pool.reset();
+    }
+}
+
+/***********************************************************************
+ *  PxLFramePool
+ */
+
+shared_ptr<PxLFramePool> PxLFramePool::create(uint32_t count, uint32_t bufferSize)
+{
+    return shared_ptr<PxLFramePool>(new PxLFramePool(count, bufferSize));
+}
+
+PxLFramePool::PxLFramePool(uint32_t count, uint32_t bufferSize)
+: m_bufferSize(bufferSize)
+, m_storage(new uint8_t[static_cast<size_t>(count) * bufferSize])
+, m_slots(count)
+, m_freeMutex()
+, m_free()
+{
+    m_free.reserve(count);
+    // Hand out the lowest index first.
+    for (uint32_t i = count; i > 0; i--) m_free.push_back(i - 1);
+}
+
+PxLFrame PxLFramePool::borrow()
+{
+    uint32_t index;
+    {
+        lock_guard<mutex> lock(m_freeMutex);
+        if (m_free.empty()) return PxLFrame();
+        index = m_free.back();
+        m_free.pop_back();
+    }
+    return PxLFrame(shared_from_this(), index);
+}
+
+void PxLFramePool::giveBack(uint32_t index)
+{
+    lock_guard<mutex> lock(m_freeMutex);
+    m_free.push_back(index);
+}
@@ -0,0 +1,145 @@
+/***************************************************************************
+ *
+ *     File: frame.h
+ *
+ *     Description: Move-only frame handles backed by a pre-allocated buffer pool
+ *
+ */
+
+#if !defined(PIXELINK_FRAME_H)
+#define PIXELINK_FRAME_H
+
+#include <PixeLINKApi.h>
+#include <stdint.h>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class PxLFramePool;
+
+//
+// A frame borrowed from a PxLFramePool. The buffer goes back to its pool when the
+// frame is destroyed or assigned to, so a frame can be moved between pipeline stages
+// without copying the image data.
+//
+class PxLFrame
+{
+    friend class PxLFramePool;
+public:
+    PxLFrame();
+    PxLFrame(PxLFrame&& other) noexcept;
+    PxLFrame& operator=(PxLFrame&& other) noexcept;
+    PxLFrame(const PxLFrame&) = delete;
+    PxLFrame& operator=(const PxLFrame&) = delete;
+    ~PxLFrame();
+
+    bool valid() const;
+    uint8_t* data() const;
+    uint32_t size() const;
+    FRAME_DESC* desc() const;
+    // host time at which the frame was handed over by the SDK
+    std::chrono::system_clock::time_point arrival() const;
+    void setArrival(std::chrono::system_clock::time_point arrival);
+    // camera frame time in seconds at full precision, see FrameTime
+    double cameraTime() const;
+    void setCameraTime(double cameraTime);
+
+    // return the buffer to the pool before the frame goes out of scope
+    void release();
+
+private:
+    PxLFrame(const std::shared_ptr<PxLFramePool>& pool, uint32_t index);
+
+    std::shared_ptr<PxLFramePool> m_pool;
+    uint32_t m_index;
+};
+
+//
+// A fixed number of equally sized frame buffers. All memory is allocated up front;
+// borrowing and returning a buffer only moves an index between the free list and a frame.
+//
+class PxLFramePool : public std::enable_shared_from_this<PxLFramePool>
+{
+    friend class PxLFrame;
+public:
+    static std::shared_ptr<PxLFramePool> create(uint32_t count, uint32_t bufferSize);
+
+    // returns an invalid frame if all buffers are borrowed
+    PxLFrame borrow();
+
+    uint32_t count() const;
+    uint32_t bufferSize() const;
+
+private:
+    PxLFramePool(uint32_t count, uint32_t bufferSize);
+    PxLFramePool(const PxLFramePool&) = delete;
+    PxLFramePool& operator=(const PxLFramePool&) = delete;
+
+    void giveBack(uint32_t index);
+
+    struct Slot
+    {
+        FRAME_DESC desc{};
+        std::chrono::system_clock::time_point arrival{};
+        double cameraTime{0.0};
+    };
+
+    uint32_t m_bufferSize;
+    std::unique_ptr<uint8_t[]> m_storage;
+    std::vector<Slot> m_slots;
+    std::mutex m_freeMutex;
+    std::vector<uint32_t> m_free;
+};
+
+inline bool PxLFrame::valid() const
+{
+    return (nullptr != m_pool);
+}
+
+inline uint8_t* PxLFrame::data() const
+{
+    return m_pool ? m_pool->m_storage.get() + static_cast<size_t>(m_index) * m_pool->m_bufferSize : nullptr;
+}
+
+inline uint32_t PxLFrame::size() const
+{
+    return m_pool ? m_pool->m_bufferSize : 0;
+}
+
+inline FRAME_DESC* PxLFrame::desc() const
+{
+    return m_pool ? &m_pool->m_slots[m_index].desc : nullptr;
+}
+
+inline std::chrono::system_clock::time_point PxLFrame::arrival() const
+{
+    return m_pool ? m_pool->m_slots[m_index].arrival : std::chrono::system_clock::time_point();
+}
+
+inline void PxLFrame::setArrival(std::chrono::system_clock::time_point arrival)
+{
+    if (m_pool) m_pool->m_slots[m_index].arrival = arrival;
+}
+
+inline double PxLFrame::cameraTime() const
+{
+    return m_pool ? m_pool->m_slots[m_index].cameraTime : 0.0;
+}
+
+inline void PxLFrame::setCameraTime(double cameraTime)
+{
+    if (m_pool) m_pool->m_slots[m_index].cameraTime = cameraTime;
+}
+
+inline uint32_t PxLFramePool::count() const
+{
+    return static_cast<uint32_t>(m_slots.size());
+}
+
+inline uint32_t PxLFramePool::bufferSize() const
+{
+    return m_bufferSize;
+}
+
+#endif // !defined(PIXELINK_FRAME_H)
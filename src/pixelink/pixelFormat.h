@@ -43,6 +43,7 @@ inline PXL_PIXEL_FORMATS PxLPixelFormat_fromApi(float apiPixelFormat)
         return MONO8;
     case PIXEL_FORMAT_MONO16:
         return MONO16;
+    case PIXEL_FORMAT_MONO12_PACKED:
     case PIXEL_FORMAT_MONO12_PACKED_MSFIRST:
         return MONO12_PACKED;
     case PIXEL_FORMAT_BAYER8:
@@ -55,6 +56,10 @@ inline PXL_PIXEL_FORMATS PxLPixelFormat_fromApi(float apiPixelFormat)
     case PIXEL_FORMAT_BAYER16_GBRG:
     case PIXEL_FORMAT_BAYER16_BGGR:
         return BAYER16;
+    case PIXEL_FORMAT_BAYER12_PACKED:
+    case PIXEL_FORMAT_BAYER12_RGGB_PACKED:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED:
+    case PIXEL_FORMAT_BAYER12_BGGR_PACKED:
     case PIXEL_FORMAT_BAYER12_PACKED_MSFIRST:
     case PIXEL_FORMAT_BAYER12_RGGB_PACKED_MSFIRST:
     case PIXEL_FORMAT_BAYER12_GBRG_PACKED_MSFIRST:
@@ -67,6 +72,22 @@ inline PXL_PIXEL_FORMATS PxLPixelFormat_fromApi(float apiPixelFormat)
     }
 }
 
+// true for the 12 bit packed formats that start with the most significant bits
+inline bool PxLPixelFormat_isMsFirst(float apiPixelFormat)
+{
+    switch ((int)apiPixelFormat)
+    {
+    case PIXEL_FORMAT_MONO12_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_RGGB_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_BGGR_PACKED_MSFIRST:
+        return true;
+    default:
+        return false;
+    }
+}
+
 inline float PxLPixelFormat_toApi (PXL_PIXEL_FORMATS pixelFormat)
 {
     switch (pixelFormat)
@@ -82,4 +103,57 @@ inline float PxLPixelFormat_toApi (PXL_PIXEL_FORMATS pixelFormat)
     }
 }
 
+// Colour filter layout of Bayer frames, named after the first two pixels of the
+// first two rows. The values encode the position of red: bit 0 is set if red is
+// in odd columns, bit 1 if red is in odd rows.
+typedef enum _PXL_BAYER_PATTERNS
+{
+   BAYER_PATTERN_RGGB = 0,
+   BAYER_PATTERN_GRBG = 1,
+   BAYER_PATTERN_GBRG = 2,
+   BAYER_PATTERN_BGGR = 3,
+   BAYER_PATTERN_NONE
+} PXL_BAYER_PATTERNS;
+
+//
+// The pixel format names the layout of the sensor; flipping the image horizontally
+// moves red into the other column of each 2x2 cell and flipping it vertically into
+// the other row. Returns BAYER_PATTERN_NONE for formats without colour filter.
+inline PXL_BAYER_PATTERNS PxLBayerPattern_fromApi(float apiPixelFormat, bool horizontalFlip, bool verticalFlip)
+{
+    int pattern;
+    switch ((int)apiPixelFormat)
+    {
+    case PIXEL_FORMAT_BAYER8_RGGB:
+    case PIXEL_FORMAT_BAYER16_RGGB:
+    case PIXEL_FORMAT_BAYER12_RGGB_PACKED:
+    case PIXEL_FORMAT_BAYER12_RGGB_PACKED_MSFIRST:
+        pattern = BAYER_PATTERN_RGGB;
+        break;
+    case PIXEL_FORMAT_BAYER8_GRBG:
+    case PIXEL_FORMAT_BAYER16_GRBG:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED_MSFIRST:
+        pattern = BAYER_PATTERN_GRBG;
+        break;
+    case PIXEL_FORMAT_BAYER8_GBRG:
+    case PIXEL_FORMAT_BAYER16_GBRG:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED_MSFIRST:
+        pattern = BAYER_PATTERN_GBRG;
+        break;
+    case PIXEL_FORMAT_BAYER8_BGGR:
+    case PIXEL_FORMAT_BAYER16_BGGR:
+    case PIXEL_FORMAT_BAYER12_BGGR_PACKED:
+    case PIXEL_FORMAT_BAYER12_BGGR_PACKED_MSFIRST:
+        pattern = BAYER_PATTERN_BGGR;
+        break;
+    default:
+        return BAYER_PATTERN_NONE;
+    }
+    if (horizontalFlip) pattern ^= 1;
+    if (verticalFlip)   pattern ^= 2;
+    return (PXL_BAYER_PATTERNS)pattern;
+}
+
 #endif // !defined(PIXELINK_PIXEL_FORMAT_H)
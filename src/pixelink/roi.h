@@ -17,10 +17,16 @@
 class PXL_ROI
 {
 public:
-    bool operator==(const PXL_ROI& rhs) {return (rhs.m_width==this->m_width && rhs.m_height==this->m_height);}
+    // A negative left or top asks setRoiValue to center the ROI in that direction.
+    static const int CENTERED = -1;
+
+    bool operator==(const PXL_ROI& rhs) {return (rhs.m_width==this->m_width && rhs.m_height==this->m_height &&
+                                                 rhs.m_left==this->m_left && rhs.m_top==this->m_top);}
     bool operator!=(const PXL_ROI& rhs) {return !operator==(rhs);}
     int m_width;
     int m_height;
+    int m_left;
+    int m_top;
 };
 
 #endif // !defined(PIXELINK_ROI_H)
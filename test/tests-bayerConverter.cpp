@@ -0,0 +1,391 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline/bayerConverter.h"
+#include "pipeline/monoConverter.h"
+#include "pipeline/yuv422Converter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Multiples of 4 for Demosaic::SUPERPIXEL; the row pairs do not divide
+// into 3 or 7 equal stripes.
+const uint32_t WIDTH{52};
+const uint32_t HEIGHT{44};
+const BayerPattern PATTERNS[]{BayerPattern::RGGB, BayerPattern::GRBG, BayerPattern::GBRG, BayerPattern::BGGR};
+const char *const PATTERN_NAMES[]{"RGGB", "GRBG", "GBRG", "BGGR"};
+
+int failures{0};
+
+void check(bool condition, const std::string &what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+struct Image {
+    explicit Image(uint32_t width, uint32_t height)
+        : y(width * height)
+        , u(width * height / 4)
+        , v(width * height / 4)
+        , argb(4 * width * height)
+        , nv12(width * height * 3 / 2)
+        , gray(width * height) {}
+
+    std::vector<uint8_t> y;
+    std::vector<uint8_t> u;
+    std::vector<uint8_t> v;
+    std::vector<uint8_t> argb;
+    std::vector<uint8_t> nv12;
+    std::vector<uint8_t> gray;
+};
+
+Image convert(FrameConverter &converter, const std::vector<uint8_t> &frame) {
+    Image image{converter.outputWidth(), converter.outputHeight()};
+    converter.setExtraOutputs(image.nv12.data(), image.gray.data());
+    converter.convert(frame.data(), image.y.data(), image.u.data(), image.v.data(), image.argb.data());
+    return image;
+}
+
+Image convert(const std::vector<uint8_t> &frame, BayerFormat format, BayerPattern pattern, Demosaic demosaic, uint32_t workers,
+              YuvMatrix yuvMatrix = YuvMatrix::BT601, YuvRange yuvRange = YuvRange::LIMITED) {
+    WorkerPool workerPool{workers};
+    BayerConverter converter{WIDTH, HEIGHT, format, pattern, demosaic, workerPool, yuvMatrix, yuvRange};
+    return convert(converter, frame);
+}
+
+int32_t maxDifference(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b) {
+    int32_t difference{0};
+    for (std::size_t i{0}; i < a.size(); i++) {
+        difference = std::max(difference, std::abs(a[i] - b[i]));
+    }
+    return difference;
+}
+
+int32_t maxDifference(const Image &a, const Image &b) {
+    return std::max(std::max(maxDifference(a.y, b.y), maxDifference(a.u, b.u)), std::max(maxDifference(a.v, b.v), maxDifference(a.argb, b.argb)));
+}
+
+/**
+ * NV12 and GRAY8 must hold the same samples as the I420 planes.
+ */
+void extraOutputsAgree(const Image &image, const std::string &name) {
+    const std::size_t size{image.y.size()};
+    bool yEqual{std::equal(image.y.begin(), image.y.end(), image.nv12.begin())};
+    bool uvEqual{true};
+    for (std::size_t i{0}; i < image.u.size(); i++) {
+        uvEqual = uvEqual && (image.nv12[size + 2 * i] == image.u[i]) && (image.nv12[size + 2 * i + 1] == image.v[i]);
+    }
+    check(yEqual, name + ": NV12 Y equals I420 Y");
+    check(uvEqual, name + ": NV12 UV equals I420 U and V interleaved");
+    check(image.gray == image.y, name + ": GRAY8 equals I420 Y");
+}
+
+/**
+ * Colour of the Bayer site (x, y): 0 red, 1 green, 2 blue.
+ */
+uint32_t colourAt(BayerPattern pattern, uint32_t x, uint32_t y) {
+    const uint32_t redColumn{static_cast<uint32_t>(pattern) & 1};
+    const uint32_t redRow{(static_cast<uint32_t>(pattern) >> 1) & 1};
+    if ((x % 2 == redColumn) && (y % 2 == redRow)) {
+        return 0;
+    }
+    if ((x % 2 != redColumn) && (y % 2 != redRow)) {
+        return 2;
+    }
+    return 1;
+}
+
+/**
+ * Bilinear demosaicing one pixel at a time, mirroring row and column -1
+ * to 1 and width (height) to width-2 (height-2).
+ */
+std::vector<uint8_t> bilinearReference(const std::vector<uint8_t> &frame, BayerPattern pattern) {
+    auto at = [&frame](int32_t x, int32_t y) -> int32_t {
+        x = (x < 0) ? 1 : ((x >= static_cast<int32_t>(WIDTH)) ? WIDTH - 2 : x);
+        y = (y < 0) ? 1 : ((y >= static_cast<int32_t>(HEIGHT)) ? HEIGHT - 2 : y);
+        return frame[y * WIDTH + x];
+    };
+    std::vector<uint8_t> argb(4 * WIDTH * HEIGHT);
+    for (int32_t y{0}; y < static_cast<int32_t>(HEIGHT); y++) {
+        for (int32_t x{0}; x < static_cast<int32_t>(WIDTH); x++) {
+            int32_t rgb[3]{};
+            const uint32_t site{colourAt(pattern, x, y)};
+            if (1 == site) {
+                const uint32_t horizontal{colourAt(pattern, x + 1, y)};
+                rgb[1]              = at(x, y);
+                rgb[horizontal]     = (at(x - 1, y) + at(x + 1, y) + 1) >> 1;
+                rgb[2 - horizontal] = (at(x, y - 1) + at(x, y + 1) + 1) >> 1;
+            }
+            else {
+                rgb[site]     = at(x, y);
+                rgb[1]        = (at(x - 1, y) + at(x + 1, y) + at(x, y - 1) + at(x, y + 1) + 2) >> 2;
+                rgb[2 - site] = (at(x - 1, y - 1) + at(x + 1, y - 1) + at(x - 1, y + 1) + at(x + 1, y + 1) + 2) >> 2;
+            }
+            uint8_t *pixel{&argb[4 * (y * WIDTH + x)]};
+            pixel[0] = static_cast<uint8_t>(rgb[2]);
+            pixel[1] = static_cast<uint8_t>(rgb[1]);
+            pixel[2] = static_cast<uint8_t>(rgb[0]);
+            pixel[3] = 255;
+        }
+    }
+    return argb;
+}
+
+/**
+ * One pixel per 2x2 cell with the two greens averaged.
+ */
+std::vector<uint8_t> superpixelReference(const std::vector<uint8_t> &frame, BayerPattern pattern) {
+    std::vector<uint8_t> argb(WIDTH * HEIGHT);
+    for (uint32_t y{0}; y < HEIGHT / 2; y++) {
+        for (uint32_t x{0}; x < WIDTH / 2; x++) {
+            int32_t rgb[3]{};
+            for (uint32_t i{0}; i < 4; i++) {
+                const uint32_t column{2 * x + (i & 1)};
+                const uint32_t row{2 * y + (i >> 1)};
+                rgb[colourAt(pattern, column, row)] += frame[row * WIDTH + column];
+            }
+            uint8_t *pixel{&argb[4 * (y * WIDTH / 2 + x)]};
+            pixel[0] = static_cast<uint8_t>(rgb[2]);
+            pixel[1] = static_cast<uint8_t>((rgb[1] + 1) >> 1);
+            pixel[2] = static_cast<uint8_t>(rgb[0]);
+            pixel[3] = 255;
+        }
+    }
+    return argb;
+}
+
+/**
+ * I420 of an ARGB image in floating point in the given colour space.
+ */
+Image i420Reference(const std::vector<uint8_t> &argb, uint32_t width, uint32_t height, YuvMatrix yuvMatrix, YuvRange yuvRange) {
+    const double KR{(YuvMatrix::BT709 == yuvMatrix) ? 0.2126 : 0.299};
+    const double KB{(YuvMatrix::BT709 == yuvMatrix) ? 0.0722 : 0.114};
+    const bool limited{YuvRange::LIMITED == yuvRange};
+    const double lumaOffset{limited ? 16.0 : 0.0};
+    const double lumaScale{limited ? 219.0 / 255.0 : 1.0};
+    const double chromaScale{limited ? 224.0 / 255.0 : 1.0};
+    Image image{width, height};
+    image.argb = argb;
+    auto luma = [&](std::size_t i) {
+        return KR * argb[4 * i + 2] + (1.0 - KR - KB) * argb[4 * i + 1] + KB * argb[4 * i];
+    };
+    for (std::size_t i{0}; i < width * height; i++) {
+        image.y[i] = static_cast<uint8_t>(std::lround(lumaOffset + lumaScale * luma(i)));
+    }
+    for (uint32_t y{0}; y < height / 2; y++) {
+        for (uint32_t x{0}; x < width / 2; x++) {
+            double l{0.0}, r{0.0}, b{0.0};
+            for (uint32_t i{0}; i < 4; i++) {
+                const std::size_t pixel{(2 * y + (i >> 1)) * width + 2 * x + (i & 1)};
+                l += luma(pixel) / 4.0;
+                r += argb[4 * pixel + 2] / 4.0;
+                b += argb[4 * pixel] / 4.0;
+            }
+            const double u{128.0 + chromaScale * (b - l) / (2.0 * (1.0 - KB))};
+            const double v{128.0 + chromaScale * (r - l) / (2.0 * (1.0 - KR))};
+            image.u[y * width / 2 + x] = static_cast<uint8_t>(std::lround(std::min(std::max(u, 0.0), 255.0)));
+            image.v[y * width / 2 + x] = static_cast<uint8_t>(std::lround(std::min(std::max(v, 0.0), 255.0)));
+        }
+    }
+    return image;
+}
+
+/**
+ * Random 12 bit samples in every layout the converter reads.
+ */
+struct Frames {
+    Frames()
+        : samples(WIDTH * HEIGHT)
+        , bayer8(WIDTH * HEIGHT)
+        , bayer16(2 * WIDTH * HEIGHT)
+        , lsFirst(3 * WIDTH * HEIGHT / 2)
+        , msFirst(3 * WIDTH * HEIGHT / 2) {
+        std::mt19937 generator{42};
+        std::uniform_int_distribution<uint32_t> sample{0, 4095};
+        for (uint32_t &s : samples) {
+            s = sample(generator);
+        }
+        for (std::size_t i{0}; i < samples.size(); i++) {
+            bayer8[i]          = static_cast<uint8_t>(samples[i] >> 4);
+            bayer16[2 * i]     = static_cast<uint8_t>(samples[i] >> 4);
+            bayer16[2 * i + 1] = static_cast<uint8_t>(samples[i] << 4);
+        }
+        for (std::size_t i{0}; i < samples.size() / 2; i++) {
+            const uint32_t s0{samples[2 * i]};
+            const uint32_t s1{samples[2 * i + 1]};
+            lsFirst[3 * i]     = static_cast<uint8_t>(s0);
+            lsFirst[3 * i + 1] = static_cast<uint8_t>((s0 >> 8) | ((s1 & 0x0F) << 4));
+            lsFirst[3 * i + 2] = static_cast<uint8_t>(s1 >> 4);
+            msFirst[3 * i]     = static_cast<uint8_t>(s0 >> 4);
+            msFirst[3 * i + 1] = static_cast<uint8_t>((s0 & 0x0F) | ((s1 & 0x0F) << 4));
+            msFirst[3 * i + 2] = static_cast<uint8_t>(s1 >> 4);
+        }
+    }
+
+    std::vector<uint32_t> samples;
+    std::vector<uint8_t> bayer8;
+    std::vector<uint8_t> bayer16;
+    std::vector<uint8_t> lsFirst;
+    std::vector<uint8_t> msFirst;
+};
+
+const YuvMatrix MATRICES[]{YuvMatrix::BT601, YuvMatrix::BT709};
+const char *const MATRIX_NAMES[]{"BT.601", "BT.709"};
+const YuvRange RANGES[]{YuvRange::LIMITED, YuvRange::FULL};
+const char *const RANGE_NAMES[]{"limited", "full"};
+
+void againstReference(const Frames &frames) {
+    for (uint32_t m{0}; m < 2; m++) {
+        for (uint32_t r{0}; r < 2; r++) {
+            for (uint32_t p{0}; p < 4; p++) {
+                const std::string name{std::string{PATTERN_NAMES[p]} + " " + MATRIX_NAMES[m] + " " + RANGE_NAMES[r]};
+                const Image bilinear{convert(frames.bayer8, BayerFormat::BAYER8, PATTERNS[p], Demosaic::BILINEAR, 1, MATRICES[m], RANGES[r])};
+                const Image bilinearExpected{
+                    i420Reference(bilinearReference(frames.bayer8, PATTERNS[p]), WIDTH, HEIGHT, MATRICES[m], RANGES[r])};
+                check(0 == maxDifference(bilinear.argb, bilinearExpected.argb), name + ": bilinear ARGB equals the reference");
+                check(1 >= maxDifference(bilinear, bilinearExpected), name + ": bilinear I420 within 1 of the reference");
+
+                const Image superpixel{convert(frames.bayer8, BayerFormat::BAYER8, PATTERNS[p], Demosaic::SUPERPIXEL, 1, MATRICES[m], RANGES[r])};
+                const Image superpixelExpected{
+                    i420Reference(superpixelReference(frames.bayer8, PATTERNS[p]), WIDTH / 2, HEIGHT / 2, MATRICES[m], RANGES[r])};
+                check(0 == maxDifference(superpixel.argb, superpixelExpected.argb), name + ": superpixel ARGB equals the reference");
+                check(1 >= maxDifference(superpixel, superpixelExpected), name + ": superpixel I420 within 1 of the reference");
+            }
+        }
+    }
+}
+
+/**
+ * Grey frames are their own luma with neutral chroma, so the reference is
+ * exact; in limited range Y goes through the converter's table. The ramp
+ * holds every grey value, so the whole table is covered.
+ */
+void monoAgainstReference(const Frames &frames) {
+    std::vector<uint8_t> ramp(WIDTH * HEIGHT);
+    for (std::size_t i{0}; i < ramp.size(); i++) {
+        ramp[i] = static_cast<uint8_t>(i);
+    }
+    const std::vector<uint8_t> *FRAMES[]{&frames.bayer8, &ramp};
+    for (uint32_t r{0}; r < 2; r++) {
+        for (const std::vector<uint8_t> *grey : FRAMES) {
+            std::vector<uint8_t> argb(4 * WIDTH * HEIGHT);
+            for (std::size_t i{0}; i < grey->size(); i++) {
+                argb[4 * i]     = (*grey)[i];
+                argb[4 * i + 1] = (*grey)[i];
+                argb[4 * i + 2] = (*grey)[i];
+                argb[4 * i + 3] = 255;
+            }
+            // A converter per frame: it only writes the constant chroma
+            // to planes it has not seen before.
+            WorkerPool workerPool{3};
+            MonoConverter converter{WIDTH, HEIGHT, workerPool, RANGES[r]};
+            check(0 == maxDifference(convert(converter, *grey), i420Reference(argb, WIDTH, HEIGHT, YuvMatrix::BT601, RANGES[r])),
+                  std::string{"mono "} + RANGE_NAMES[r] + ((grey == &ramp) ? ": ramp" : ": random frame") + " equals the reference");
+        }
+    }
+}
+
+void formatsAgree(const Frames &frames) {
+    for (uint32_t p{0}; p < 4; p++) {
+        for (const Demosaic demosaic : {Demosaic::BILINEAR, Demosaic::SUPERPIXEL}) {
+            const std::string name{std::string{PATTERN_NAMES[p]} + ((Demosaic::BILINEAR == demosaic) ? " bilinear" : " superpixel")};
+            const Image bayer8{convert(frames.bayer8, BayerFormat::BAYER8, PATTERNS[p], demosaic, 1)};
+            const Image bayer16{convert(frames.bayer16, BayerFormat::BAYER16, PATTERNS[p], demosaic, 1)};
+            const Image lsFirst{convert(frames.lsFirst, BayerFormat::BAYER12_PACKED, PATTERNS[p], demosaic, 1)};
+            const Image msFirst{convert(frames.msFirst, BayerFormat::BAYER12_PACKED_MSFIRST, PATTERNS[p], demosaic, 1)};
+            check(1 >= maxDifference(bayer8, bayer16), name + ": 8 and 16 bit within 1");
+            check(0 == maxDifference(bayer16, lsFirst), name + ": 16 bit and 12 bit packed equal");
+            check(0 == maxDifference(bayer16, msFirst), name + ": 16 bit and 12 bit packed MS first equal");
+        }
+    }
+}
+
+void stripesAgree(const Frames &frames) {
+    const BayerFormat FORMATS[]{BayerFormat::BAYER8, BayerFormat::BAYER12_PACKED, BayerFormat::BAYER12_PACKED_MSFIRST, BayerFormat::BAYER16};
+    const std::vector<uint8_t> *FRAMES[]{&frames.bayer8, &frames.lsFirst, &frames.msFirst, &frames.bayer16};
+    for (uint32_t p{0}; p < 4; p++) {
+        for (uint32_t f{0}; f < 4; f++) {
+            for (const Demosaic demosaic : {Demosaic::BILINEAR, Demosaic::SUPERPIXEL}) {
+                const Image one{convert(*FRAMES[f], FORMATS[f], PATTERNS[p], demosaic, 1)};
+                extraOutputsAgree(one, std::string{PATTERN_NAMES[p]} + ": 1 stripe");
+                for (const uint32_t workers : {3u, 7u}) {
+                    const Image many{convert(*FRAMES[f], FORMATS[f], PATTERNS[p], demosaic, workers)};
+                    check(0 == maxDifference(one, many), std::string{PATTERN_NAMES[p]} + ": " + std::to_string(workers) + " stripes equal 1 stripe");
+                    extraOutputsAgree(many, std::string{PATTERN_NAMES[p]} + ": " + std::to_string(workers) + " stripes");
+                }
+            }
+        }
+    }
+}
+
+void monoStripesAgree(const Frames &frames) {
+    for (const YuvRange range : {YuvRange::FULL, YuvRange::LIMITED}) {
+        WorkerPool single{1};
+        MonoConverter singleConverter{WIDTH, HEIGHT, single, range};
+        const Image one{convert(singleConverter, frames.bayer8)};
+        extraOutputsAgree(one, "mono: 1 stripe");
+        for (const uint32_t workers : {3u, 7u}) {
+            WorkerPool workerPool{workers};
+            MonoConverter converter{WIDTH, HEIGHT, workerPool, range};
+            const Image many{convert(converter, frames.bayer8)};
+            check(0 == maxDifference(one, many), "mono: " + std::to_string(workers) + " stripes equal 1 stripe");
+            extraOutputsAgree(many, "mono: " + std::to_string(workers) + " stripes");
+        }
+    }
+}
+
+void yuv422StripesAgree(const Frames &frames) {
+    // Any bytes make valid UYVY.
+    std::vector<uint8_t> uyvy(2 * WIDTH * HEIGHT);
+    for (std::size_t i{0}; i < uyvy.size(); i++) {
+        uyvy[i] = frames.bayer16[i];
+    }
+    WorkerPool single{1};
+    Yuv422Converter singleConverter{WIDTH, HEIGHT, single};
+    const Image one{convert(singleConverter, uyvy)};
+    extraOutputsAgree(one, "UYVY: 1 stripe");
+    for (const uint32_t workers : {3u, 7u}) {
+        WorkerPool workerPool{workers};
+        Yuv422Converter converter{WIDTH, HEIGHT, workerPool};
+        const Image many{convert(converter, uyvy)};
+        check(0 == maxDifference(one, many), "UYVY: " + std::to_string(workers) + " stripes equal 1 stripe");
+        extraOutputsAgree(many, "UYVY: " + std::to_string(workers) + " stripes");
+    }
+}
+
+} // namespace
+
+int32_t main() {
+    const Frames frames;
+    againstReference(frames);
+    monoAgainstReference(frames);
+    formatsAgree(frames);
+    stripesAgree(frames);
+    monoStripesAgree(frames);
+    yuv422StripesAgree(frames);
+    return (0 == failures) ? 0 : 1;
+}
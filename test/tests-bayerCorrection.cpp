@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline/bayerCorrection.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const uint32_t WIDTH{32};
+const uint32_t HEIGHT{12};
+
+int failures{0};
+
+void check(bool condition, const std::string &what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+/**
+ * Writes contents to a file in the working directory and returns its name.
+ */
+std::string file(const std::string &name, const std::string &contents) {
+    const std::string path{"tests-bayerCorrection-" + name + ".txt"};
+    std::ofstream out{path};
+    out << contents;
+    return path;
+}
+
+/**
+ * A distinct value per pixel, so that every replacement tells where it
+ * came from.
+ */
+uint16_t value(uint32_t x, uint32_t y) {
+    return static_cast<uint16_t>(1000 + 100 * y + 7 * x);
+}
+
+std::vector<uint16_t> correct(const BayerCorrection &correction, uint32_t y) {
+    std::vector<uint16_t> row(WIDTH);
+    for (uint32_t x{0}; x < WIDTH; x++) {
+        row[x] = value(x, y);
+    }
+    std::vector<uint16_t> out(WIDTH);
+    std::vector<uint16_t> gains(WIDTH);
+    correction.correct(row.data(), y, out.data(), gains.data());
+    return out;
+}
+
+uint16_t average(uint16_t a, uint16_t b) {
+    return static_cast<uint16_t>((a + b + 1) / 2);
+}
+
+void defects() {
+    // Without black level and shading, only the defects change.
+    BayerCorrection correction{WIDTH, HEIGHT, 0xFFFFu, 0};
+    const std::string path{file("defects", "# x y\n"
+                                           "10 3\n"
+                                           "20 3\n22 3\n"
+                                           "0 5\n31 5\n"
+                                           "0 6\n2 6\n"
+                                           "5 7\n7 7\n9 7\n6 7\n")};
+    check(correction.loadDefects(path), "defects load");
+
+    const std::vector<uint16_t> row3{correct(correction, 3)};
+    check(row3[10] == average(value(8, 3), value(12, 3)), "isolated defect is the average of its same-colour neighbours");
+    check(row3[20] == average(value(18, 3), value(24, 3)), "left of two adjacent defects skips the right one");
+    check(row3[22] == average(value(18, 3), value(24, 3)), "right of two adjacent defects skips the left one");
+    check(row3[21] == value(21, 3), "pixels between adjacent defects are kept");
+
+    const std::vector<uint16_t> row5{correct(correction, 5)};
+    check(row5[0] == value(2, 5), "defect in the first column takes its right neighbour");
+    check(row5[31] == value(29, 5), "defect in the last column takes its left neighbour");
+
+    const std::vector<uint16_t> row6{correct(correction, 6)};
+    check((row6[0] == value(4, 6)) && (row6[2] == value(4, 6)), "run of defects at the border takes the first intact pixel");
+
+    const std::vector<uint16_t> row7{correct(correction, 7)};
+    check(row7[7] == average(value(3, 7), value(11, 7)), "run of three defects skips both others");
+    check(row7[6] == average(value(4, 7), value(8, 7)), "defects of the other colour do not matter");
+
+    const std::vector<uint16_t> row4{correct(correction, 4)};
+    bool unchanged{true};
+    for (uint32_t x{0}; x < WIDTH; x++) {
+        unchanged = unchanged && (row4[x] == value(x, 4));
+    }
+    check(unchanged, "rows without defects are unchanged");
+
+    BayerCorrection rejecting{WIDTH, HEIGHT, 0xFFFFu, 0};
+    check(!rejecting.loadDefects(file("outside", "32 0\n")), "defects outside the frame are rejected");
+    check(!rejecting.loadDefects(file("malformed", "3\n")), "malformed defect lines are rejected");
+    check(!rejecting.loadDefects("tests-bayerCorrection-missing.txt"), "missing defect files are rejected");
+}
+
+void blackLevel() {
+    const uint32_t BLACK{16};
+    BayerCorrection correction{WIDTH, HEIGHT, 255, BLACK};
+    std::vector<uint8_t> row(WIDTH);
+    for (uint32_t x{0}; x < WIDTH; x++) {
+        row[x] = static_cast<uint8_t>((x < 20) ? x : 255 - (WIDTH - 1 - x) * 10);
+    }
+    std::vector<uint8_t> out(WIDTH);
+    std::vector<uint16_t> gains(WIDTH);
+    correction.correct(row.data(), 0, out.data(), gains.data());
+    bool clamped{true};
+    bool stretched{true};
+    const double stretch{255.0 / (255.0 - BLACK)};
+    for (uint32_t x{0}; x < WIDTH; x++) {
+        if (row[x] <= BLACK) {
+            clamped = clamped && (0 == out[x]);
+        }
+        else {
+            stretched = stretched && (std::fabs(out[x] - (row[x] - BLACK) * stretch) <= 1.0);
+        }
+    }
+    check(clamped, "samples at or below the black level become 0");
+    check(stretched, "samples above the black level are stretched to the full range");
+    check(255 == out[WIDTH - 1], "white stays white");
+}
+
+void shading() {
+    // 3 x 2 nodes; gains per node for even/even, even/odd, odd/even, odd/odd.
+    const double NODES[2][3][4]{{{1.0, 1.5, 2.0, 2.5}, {1.2, 1.2, 1.2, 1.2}, {3.0, 1.0, 0.5, 2.0}},
+                                {{2.0, 2.0, 1.0, 1.0}, {0.8, 1.6, 2.4, 3.2}, {1.0, 1.0, 1.0, 1.0}}};
+    std::string contents{"# columns rows\n3 2\n"};
+    for (uint32_t r{0}; r < 2; r++) {
+        for (uint32_t c{0}; c < 3; c++) {
+            for (uint32_t i{0}; i < 4; i++) {
+                contents += std::to_string(NODES[r][c][i]) + ((3 == i) ? "\n" : " ");
+            }
+        }
+    }
+    const uint32_t BLACK{64};
+    BayerCorrection correction{WIDTH, HEIGHT, 0xFFFFu, BLACK};
+    check(correction.loadShading(file("shading", contents)), "shading loads");
+
+    const double stretch{65535.0 / (65535.0 - BLACK)};
+    double worst{0.0};
+    bool corners{true};
+    for (uint32_t y{0}; y < HEIGHT; y++) {
+        const std::vector<uint16_t> out{correct(correction, y)};
+        const double row{static_cast<double>(y) / (HEIGHT - 1)};
+        for (uint32_t x{0}; x < WIDTH; x++) {
+            const double position{2.0 * x / (WIDTH - 1)};
+            const uint32_t column{std::min(static_cast<uint32_t>(position), 1u)};
+            const double weight{position - column};
+            const uint32_t channel{(y & 1) * 2 + (x & 1)};
+            auto node = [&](uint32_t r) {
+                return NODES[r][column][channel] * (1.0 - weight) + NODES[r][column + 1][channel] * weight;
+            };
+            const double gain{(node(0) * (1.0 - row) + node(1) * row) * stretch};
+            const double expected{std::min((value(x, y) - BLACK) * gain, 65535.0)};
+            // The gains are fixed point with 12 fractional bits.
+            const double error{std::fabs(out[x] - expected) / std::max(1.0, expected / 4096.0)};
+            worst = std::max(worst, error);
+            if (((0 == x) || (WIDTH - 1 == x)) && ((0 == y) || (HEIGHT - 1 == y))) {
+                const double nodeGain{NODES[(0 == y) ? 0 : 1][(0 == x) ? 0 : 2][channel] * stretch};
+                corners = corners && (std::fabs(out[x] - (value(x, y) - BLACK) * nodeGain) <= 1.0);
+            }
+        }
+    }
+    check(worst <= 3.0, "shading is interpolated bilinearly between the nodes (" + std::to_string(worst) + ")");
+    check(corners, "pixels at the corners get the corner nodes' gains");
+
+    BayerCorrection rejecting{WIDTH, HEIGHT, 0xFFFFu, 0};
+    check(!rejecting.loadShading(file("short", "3 2\n1 1 1 1\n")), "shading with too few gains is rejected");
+    check(!rejecting.loadShading(file("negative", "2 2\n1 1 1 1\n1 1 1 1\n1 1 1 1\n1 1 1 -1\n")), "negative shading gains are rejected");
+    check(!rejecting.loadShading(file("grid", "1 2\n1 1 1 1\n1 1 1 1\n")), "grids with fewer than 2 nodes per direction are rejected");
+}
+
+} // namespace
+
+int32_t main() {
+    defects();
+    blackLevel();
+    shading();
+    return (0 == failures) ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline/bayerDownsampler.h"
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 26 x 22 Bayer cells.
+const uint32_t WIDTH{52};
+const uint32_t HEIGHT{44};
+const BayerPattern PATTERNS[]{BayerPattern::RGGB, BayerPattern::GRBG, BayerPattern::GBRG, BayerPattern::BGGR};
+const char *const PATTERN_NAMES[]{"RGGB", "GRBG", "GBRG", "BGGR"};
+
+int failures{0};
+
+void check(bool condition, const std::string &what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+/**
+ * Colour of the Bayer site (x, y): 0 red, 1 green, 2 blue.
+ */
+uint32_t colourAt(BayerPattern pattern, uint32_t x, uint32_t y) {
+    const uint32_t redColumn{static_cast<uint32_t>(pattern) & 1};
+    const uint32_t redRow{(static_cast<uint32_t>(pattern) >> 1) & 1};
+    if ((x % 2 == redColumn) && (y % 2 == redRow)) {
+        return 0;
+    }
+    if ((x % 2 != redColumn) && (y % 2 != redRow)) {
+        return 2;
+    }
+    return 1;
+}
+
+/**
+ * Averages the 8 most significant bits of the samples of each colour in
+ * every block of cells, rounding halves up. Block i along an axis of n
+ * cells and m outputs covers cells [i*n/m, (i+1)*n/m).
+ */
+std::vector<uint8_t> reference(const std::vector<uint32_t> &samples, BayerPattern pattern, uint32_t outputWidth, uint32_t outputHeight) {
+    std::vector<uint8_t> rgb(3 * outputWidth * outputHeight);
+    for (uint32_t oy{0}; oy < outputHeight; oy++) {
+        for (uint32_t ox{0}; ox < outputWidth; ox++) {
+            uint64_t sums[3]{};
+            uint64_t counts[3]{};
+            for (uint32_t y{2 * (oy * (HEIGHT / 2) / outputHeight)}; y < 2 * ((oy + 1) * (HEIGHT / 2) / outputHeight); y++) {
+                for (uint32_t x{2 * (ox * (WIDTH / 2) / outputWidth)}; x < 2 * ((ox + 1) * (WIDTH / 2) / outputWidth); x++) {
+                    const uint32_t colour{colourAt(pattern, x, y)};
+                    sums[colour] += samples[y * WIDTH + x] >> 4;
+                    counts[colour]++;
+                }
+            }
+            for (uint32_t c{0}; c < 3; c++) {
+                rgb[3 * (oy * outputWidth + ox) + c] = static_cast<uint8_t>((2 * sums[c] + counts[c]) / (2 * counts[c]));
+            }
+        }
+    }
+    return rgb;
+}
+
+/**
+ * Random 12 bit samples in every layout the downsampler reads.
+ */
+struct Frames {
+    Frames()
+        : samples(WIDTH * HEIGHT)
+        , bayer8(WIDTH * HEIGHT)
+        , bayer16(2 * WIDTH * HEIGHT)
+        , lsFirst(3 * WIDTH * HEIGHT / 2)
+        , msFirst(3 * WIDTH * HEIGHT / 2) {
+        std::mt19937 generator{7};
+        std::uniform_int_distribution<uint32_t> sample{0, 4095};
+        for (uint32_t &s : samples) {
+            s = sample(generator);
+        }
+        for (std::size_t i{0}; i < samples.size(); i++) {
+            bayer8[i]          = static_cast<uint8_t>(samples[i] >> 4);
+            bayer16[2 * i]     = static_cast<uint8_t>(samples[i] >> 4);
+            bayer16[2 * i + 1] = static_cast<uint8_t>(samples[i] << 4);
+        }
+        for (std::size_t i{0}; i < samples.size() / 2; i++) {
+            const uint32_t s0{samples[2 * i]};
+            const uint32_t s1{samples[2 * i + 1]};
+            lsFirst[3 * i]     = static_cast<uint8_t>(s0);
+            lsFirst[3 * i + 1] = static_cast<uint8_t>((s0 >> 8) | ((s1 & 0x0F) << 4));
+            lsFirst[3 * i + 2] = static_cast<uint8_t>(s1 >> 4);
+            msFirst[3 * i]     = static_cast<uint8_t>(s0 >> 4);
+            msFirst[3 * i + 1] = static_cast<uint8_t>((s0 & 0x0F) | ((s1 & 0x0F) << 4));
+            msFirst[3 * i + 2] = static_cast<uint8_t>(s1 >> 4);
+        }
+    }
+
+    std::vector<uint32_t> samples;
+    std::vector<uint8_t> bayer8;
+    std::vector<uint8_t> bayer16;
+    std::vector<uint8_t> lsFirst;
+    std::vector<uint8_t> msFirst;
+};
+
+} // namespace
+
+int32_t main() {
+    const Frames frames;
+    const BayerFormat FORMATS[]{BayerFormat::BAYER8, BayerFormat::BAYER12_PACKED, BayerFormat::BAYER12_PACKED_MSFIRST, BayerFormat::BAYER16};
+    const char *const FORMAT_NAMES[]{"8 bit", "12 bit packed", "12 bit packed MS first", "16 bit"};
+    const std::vector<uint8_t> *FRAMES[]{&frames.bayer8, &frames.lsFirst, &frames.msFirst, &frames.bayer16};
+    // Blocks of 3 or 4 by 4 or 5 cells, 2 by 2 cells, and single cells.
+    const uint32_t SIZES[][2]{{7, 5}, {13, 11}, {WIDTH / 2, HEIGHT / 2}};
+    for (uint32_t p{0}; p < 4; p++) {
+        for (const auto &size : SIZES) {
+            const std::vector<uint8_t> expected{reference(frames.samples, PATTERNS[p], size[0], size[1])};
+            for (uint32_t f{0}; f < 4; f++) {
+                for (const uint32_t workers : {1u, 3u}) {
+                    WorkerPool workerPool{workers};
+                    BayerDownsampler downsampler{WIDTH, HEIGHT, FORMATS[f], PATTERNS[p], size[0], size[1], workerPool};
+                    std::vector<uint8_t> rgb(3 * size[0] * size[1]);
+                    downsampler.downsample(FRAMES[f]->data(), rgb.data());
+                    check(rgb == expected, std::string{PATTERN_NAMES[p]} + " " + FORMAT_NAMES[f] + " to " + std::to_string(size[0]) + "x" +
+                                               std::to_string(size[1]) + " with " + std::to_string(workers) + " tasks equals block averages");
+                }
+            }
+        }
+    }
+    return (0 == failures) ? 0 : 1;
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline/bayerConverter.h"
+#include "pipeline/colourCorrection.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const uint32_t WIDTH{32};
+const uint32_t HEIGHT{16};
+
+int failures{0};
+
+void check(bool condition, const std::string &what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+/**
+ * Writes contents to a file in the working directory and returns its name.
+ */
+std::string file(const std::string &name, const std::string &contents) {
+    const std::string path{"tests-colourCorrection-" + name + ".txt"};
+    std::ofstream out{path};
+    out << contents;
+    return path;
+}
+
+/**
+ * Warm white balance and a matrix with distinct columns, so that folding
+ * the gains into rows instead of columns shows.
+ */
+ColourCorrection::Parameters parameters() {
+    ColourCorrection::Parameters p;
+    p.gamma           = 2.2f;
+    p.whiteBalance[0] = 1.9f;
+    p.whiteBalance[1] = 1.0f;
+    p.whiteBalance[2] = 1.4f;
+    const float matrix[9]{1.6f, -0.4f, -0.2f, -0.3f, 1.5f, -0.2f, 0.1f, -0.6f, 1.5f};
+    std::copy(matrix, matrix + 9, p.matrix);
+    return p;
+}
+
+/**
+ * The corrected colour in [0, 255] of a linear colour in [0, 1] after the
+ * white balance and the matrix, in floating point.
+ */
+double gammaCorrected(double linear, float gamma) {
+    return 255.0 * std::pow(std::min(std::max(linear, 0.0), 1.0), 1.0 / gamma);
+}
+
+void tables() {
+    const ColourCorrection::Parameters p{parameters()};
+    const ColourCorrection colour{p};
+    bool folded{true};
+    for (uint32_t i{0}; i < 9; i++) {
+        const long expected{std::lround(p.matrix[i] * p.whiteBalance[i % 3] * (1 << ColourCorrection::MATRIX_BITS))};
+        folded = folded && (std::labs(colour.matrix()[i] - expected) <= 1);
+    }
+    check(folded, "white balance gains scale the matrix columns in fixed point");
+
+    const double last{(1u << ColourCorrection::LUT_BITS) - 1.0};
+    bool gamma{true};
+    for (uint32_t i{0}; i < (1u << ColourCorrection::LUT_BITS); i++) {
+        // The table is computed in float.
+        gamma = gamma && (std::labs(colour.lut()[i] - std::lround(gammaCorrected(i / last, p.gamma))) <= 1);
+    }
+    check(gamma, "gamma table follows the power curve");
+    check((0 == colour.lut()[0]) && (255 == colour.lut()[static_cast<uint32_t>(last)]), "gamma table spans [0, 255]");
+}
+
+std::vector<uint8_t> convert(const std::vector<uint8_t> &bayer, BayerFormat format, const ColourCorrection::Parameters *p) {
+    WorkerPool workers{2};
+    BayerConverter converter{WIDTH, HEIGHT, format, BayerPattern::RGGB, Demosaic::BILINEAR, workers};
+    if (nullptr != p) {
+        converter.setColour(std::make_shared<const ColourCorrection>(*p));
+    }
+    std::vector<uint8_t> i420(WIDTH * HEIGHT * 3 / 2);
+    std::vector<uint8_t> argb(4 * WIDTH * HEIGHT);
+    converter.convert(bayer.data(), i420.data(), i420.data() + WIDTH * HEIGHT, i420.data() + WIDTH * HEIGHT * 5 / 4, argb.data());
+    return argb;
+}
+
+/**
+ * Whether a colour corrected frame follows, pixel by pixel, the float
+ * reference applied to the same frame demosaiced without correction, and
+ * whether any colour was clipped. Reducing to the table's 12 bits and the
+ * fixed-point matrix move the table index by up to two, which the steep
+ * start of the gamma curve turns into several output values; the bounds
+ * follow that.
+ */
+bool againstReference(const std::vector<uint8_t> &bayer, BayerFormat format, bool &clipped) {
+    const ColourCorrection::Parameters p{parameters()};
+    const std::vector<uint8_t> plain{convert(bayer, format, nullptr)};
+    const std::vector<uint8_t> corrected{convert(bayer, format, &p)};
+    const double slack{2.0 / ((1u << ColourCorrection::LUT_BITS) - 1.0)};
+    bool within{true};
+    for (uint32_t i{0}; i < WIDTH * HEIGHT; i++) {
+        // ARGB is B, G, R, A in memory.
+        const double rgb[3]{plain[4 * i + 2] / 255.0, plain[4 * i + 1] / 255.0, plain[4 * i] / 255.0};
+        for (uint32_t c{0}; c < 3; c++) {
+            double linear{0.0};
+            for (uint32_t k{0}; k < 3; k++) {
+                linear += p.matrix[3 * c + k] * p.whiteBalance[k] * rgb[k];
+            }
+            const uint8_t actual{corrected[4 * i + 2 - c]};
+            within  = within && (actual >= std::lround(gammaCorrected(linear - slack, p.gamma))) &&
+                     (actual <= std::lround(gammaCorrected(linear + slack, p.gamma)));
+            clipped = clipped || (linear < 0.0) || (linear > 1.0);
+        }
+        within = within && (0xFF == corrected[4 * i + 3]);
+    }
+    return within;
+}
+
+void conversions() {
+    std::mt19937 generator{11};
+    std::uniform_int_distribution<uint32_t> sample{0, 255};
+    std::vector<uint8_t> bayer8(WIDTH * HEIGHT);
+    for (uint8_t &s : bayer8) {
+        s = static_cast<uint8_t>(sample(generator));
+    }
+    bool clipped{false};
+    check(againstReference(bayer8, BayerFormat::BAYER8, clipped), "8 bit: corrected colours follow the float reference");
+    check(clipped, "8 bit: test covers clipped colours");
+
+    // 16 bit samples a * 257 reduce to the same table index as the 8 bit
+    // sample a, and flat frames demosaic to exactly their colour, so the
+    // uncorrected 8 bit ARGB is the exact input here as well.
+    const uint8_t COLOURS[][3]{{0, 0, 0}, {255, 255, 255}, {200, 40, 10}, {3, 90, 250}, {128, 128, 128}, {17, 5, 1}};
+    bool within{true};
+    for (const auto &colour : COLOURS) {
+        std::vector<uint8_t> bayer16(2 * WIDTH * HEIGHT);
+        for (uint32_t y{0}; y < HEIGHT; y++) {
+            for (uint32_t x{0}; x < WIDTH; x++) {
+                // RGGB: red at even/even, blue at odd/odd.
+                const uint8_t a{colour[(y & 1) + (x & 1)]};
+                bayer16[2 * (y * WIDTH + x)]     = a;
+                bayer16[2 * (y * WIDTH + x) + 1] = a;
+            }
+        }
+        within = within && againstReference(bayer16, BayerFormat::BAYER16, clipped);
+    }
+    check(within, "16 bit: corrected colours follow the float reference");
+}
+
+void rejected() {
+    ColourCorrection::Parameters p;
+    p.gamma = 1.8f;
+    check(p.load(file("valid", "# tuned\ngamma 2.4\nwhite_balance 2 1 1.5\n\nmatrix 1 0 0 0 1 0 0 0 1\n")), "valid file loads");
+    check((std::fabs(p.gamma - 2.4f) < 1e-6f) && (std::fabs(p.whiteBalance[0] - 2.0f) < 1e-6f) && (std::fabs(p.whiteBalance[2] - 1.5f) < 1e-6f),
+          "valid file sets the parameters");
+
+    const ColourCorrection::Parameters before{p};
+    const char *const BAD[][2]{{"unknown", "saturation 1.2\n"},
+                               {"short", "matrix 1 0 0 0 1 0 0 0\n"},
+                               {"long", "white_balance 1 1 1 1\n"},
+                               {"text", "gamma high\n"},
+                               {"gamma", "gamma 0\n"},
+                               {"gain", "white_balance 1 16 1\n"},
+                               {"coefficient", "matrix 1 0 0 0 1 0 0 0 -8\n"},
+                               {"late", "gamma 2.2\nmatrix 1 0 0 0 1 0 0 0 x\n"}};
+    for (const auto &bad : BAD) {
+        check(!p.load(file(bad[0], bad[1])), std::string{bad[0]} + ": malformed file is rejected");
+    }
+    check(!p.load("tests-colourCorrection-missing.txt"), "missing file is rejected");
+    check(0 == std::memcmp(&before, &p, sizeof(p)), "rejected files leave the parameters unchanged");
+}
+
+} // namespace
+
+int32_t main() {
+    tables();
+    conversions();
+    rejected();
+    return (0 == failures) ? 0 : 1;
+}
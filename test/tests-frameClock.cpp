@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline/frameClock.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+namespace {
+
+int failures{0};
+
+void check(bool condition, const char *what, double value) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << " (" << value << ")" << std::endl;
+        ++failures;
+    }
+}
+
+/**
+ * Feeds ten minutes of 30 fps frames whose camera clock runs at ppm against
+ * the host clock. Every arrival is delayed by a fixed transport delay plus an
+ * exponential, occasionally very large, jitter.
+ */
+void drift(double ppm) {
+    const double PERIOD{1.0 / 30.0};
+    const int64_t START_US{1500000000LL * 1000 * 1000};
+    const int64_t TRANSPORT_US{2000};
+    const uint32_t FRAMES{30 * 600};
+    const uint32_t WARM_UP{120 * 30};
+
+    std::mt19937 generator{static_cast<uint32_t>(1000 + ppm)};
+    std::exponential_distribution<double> jitter{1.0 / 500.0};
+    std::bernoulli_distribution spike{0.02};
+
+    FrameClock frameClock;
+    int64_t last{0};
+    double worstOffsetUs{0.0};
+    for (uint32_t frame{0}; frame < FRAMES; frame++) {
+        const double cameraTime{0.5 + frame * PERIOD};
+        const double hostUs{static_cast<double>(START_US) + cameraTime * (1.0 + ppm * 1e-6) * 1000.0 * 1000.0};
+        const double delayUs{static_cast<double>(TRANSPORT_US) + jitter(generator) + (spike(generator) ? 40000.0 : 0.0)};
+        const int64_t mapped{frameClock.map(cameraTime, frame, static_cast<int64_t>(std::llround(hostUs + delayUs)))};
+
+        if (0 < frame) {
+            check(mapped > last, "timestamps increase monotonically", static_cast<double>(mapped - last));
+        }
+        last = mapped;
+        if (frame >= WARM_UP) {
+            const double offsetUs{static_cast<double>(mapped) - (hostUs + static_cast<double>(TRANSPORT_US))};
+            worstOffsetUs = std::max(worstOffsetUs, std::fabs(offsetUs));
+        }
+    }
+    std::cout << ppm << " ppm: estimated " << frameClock.skew() * 1e6 << " ppm, worst offset error " << worstOffsetUs << " us" << std::endl;
+    check(std::fabs(frameClock.skew() * 1e6 - ppm) < 1.0, "skew error below 1 ppm", frameClock.skew() * 1e6 - ppm);
+    check(worstOffsetUs < 100.0, "offset error below 100 us", worstOffsetUs);
+}
+
+/**
+ * The camera clock stands still (e.g., the same FRAME_DESC is delivered over
+ * and over) until the whole window holds the same sample. The fit that
+ * follows the rebuild fails; the timestamps must continue on the last line.
+ */
+void frozenClock() {
+    const uint32_t BLOCKS{8};
+    const uint32_t FRAMES_PER_BLOCK{4};
+
+    FrameClock frameClock{BLOCKS, FRAMES_PER_BLOCK};
+    uint32_t frame{0};
+    for (; frame < 4 * BLOCKS * FRAMES_PER_BLOCK; frame++) {
+        frameClock.map(frame * 0.1, frame, 1000000 + frame * 100000 + 500 + (frame % 7) * 300);
+    }
+    const double cameraTime{frame * 0.1};
+    const int64_t arrivalUs{1000000 + frame * 100000 + 500 + (frame % 7) * 300};
+    int64_t last{0};
+    for (uint32_t i{0}; i < 2 * BLOCKS * FRAMES_PER_BLOCK; i++, frame++) {
+        const int64_t mapped{frameClock.map(cameraTime, frame, arrivalUs)};
+        check(mapped >= last, "timestamps do not go backwards", static_cast<double>(mapped - last));
+        last = mapped;
+    }
+    // The last successful fit saw a single x besides the frozen one and hence
+    // passes exactly through the frozen sample.
+    check(std::llabs(last - arrivalUs) <= 1, "line is kept when the fit fails", static_cast<double>(last - arrivalUs));
+}
+
+} // namespace
+
+int32_t main() {
+    drift(-80.0);
+    drift(0.0);
+    drift(50.0);
+    frozenClock();
+    return (0 == failures) ? 0 : 1;
+}
@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline/tensorWriter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures{0};
+
+void check(bool condition, const std::string &what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+double fromFloat16(uint16_t bits) {
+    const double sign{(bits & 0x8000u) ? -1.0 : 1.0};
+    const int32_t exponent{(bits >> 10) & 0x1F};
+    const double mantissa{static_cast<double>(bits & 0x3FFu)};
+    if (0 == exponent) {
+        return sign * std::ldexp(mantissa, -24);
+    }
+    return sign * std::ldexp(1024.0 + mantissa, exponent - 25);
+}
+
+/**
+ * bits must be the float16 nearest to value: no neighbouring float16 of
+ * the same sign is closer.
+ */
+bool nearestFloat16(uint16_t bits, double value) {
+    const double error{std::fabs(fromFloat16(bits) - value)};
+    const uint16_t magnitude{static_cast<uint16_t>(bits & 0x7FFFu)};
+    const bool belowCloser{(0 < magnitude) && (std::fabs(fromFloat16(static_cast<uint16_t>(bits - 1)) - value) < error)};
+    const bool aboveCloser{(magnitude < 0x7BFFu) && (std::fabs(fromFloat16(static_cast<uint16_t>(bits + 1)) - value) < error)};
+    return !belowCloser && !aboveCloser;
+}
+
+std::vector<uint8_t> write(const std::vector<uint8_t> &argb, uint32_t width, uint32_t height, const TensorWriter::Parameters &parameters,
+                           uint32_t workers) {
+    WorkerPool workerPool{workers};
+    TensorWriter writer{width, height, parameters};
+    std::vector<uint8_t> tensor(writer.size());
+    writer.write(argb.data(), tensor.data(), workerPool);
+    return tensor;
+}
+
+double element(const std::vector<uint8_t> &tensor, const TensorWriter::Parameters &parameters, uint32_t c, uint32_t x, uint32_t y) {
+    const std::size_t index{(static_cast<std::size_t>(c) * parameters.height + y) * parameters.width + x};
+    if (TensorType::FLOAT16 == parameters.type) {
+        uint16_t bits{0};
+        std::memcpy(&bits, &tensor[TensorHeader::DATA_OFFSET + 2 * index], sizeof(bits));
+        return fromFloat16(bits);
+    }
+    return tensor[TensorHeader::DATA_OFFSET + index];
+}
+
+/**
+ * Without resizing, every tensor element is the normalised image value;
+ * the image holds all 256 values in every channel. A large stddev makes
+ * the small values subnormal in float16.
+ */
+void exactValues() {
+    const uint32_t SIZE{16};
+    std::vector<uint8_t> argb(4 * SIZE * SIZE);
+    for (uint32_t i{0}; i < SIZE * SIZE; i++) {
+        argb[4 * i]     = static_cast<uint8_t>((i * 7) & 0xFF);
+        argb[4 * i + 1] = static_cast<uint8_t>(255 - i);
+        argb[4 * i + 2] = static_cast<uint8_t>(i);
+        argb[4 * i + 3] = 255;
+    }
+    TensorWriter::Parameters parameters;
+    parameters.width  = SIZE;
+    parameters.height = SIZE;
+
+    const std::vector<uint8_t> uint8{write(argb, SIZE, SIZE, parameters, 1)};
+    bool equal{true};
+    for (uint32_t i{0}; i < SIZE * SIZE; i++) {
+        for (uint32_t c{0}; c < 3; c++) {
+            equal = equal && (uint8[TensorHeader::DATA_OFFSET + c * SIZE * SIZE + i] == argb[4 * i + 2 - c]);
+        }
+    }
+    check(equal, "uint8 without resizing equals the image in R, G, B planes");
+
+    parameters.type      = TensorType::FLOAT16;
+    parameters.mean[0]   = 0.0f;
+    parameters.mean[1]   = 0.5f;
+    parameters.mean[2]   = 0.406f;
+    parameters.stddev[0] = 4096.0f;
+    parameters.stddev[1] = 0.229f;
+    parameters.stddev[2] = 0.225f;
+    parameters.bgr       = true;
+    const std::vector<uint8_t> float16{write(argb, SIZE, SIZE, parameters, 3)};
+    bool nearest{true};
+    bool subnormal{false};
+    for (uint32_t i{0}; i < SIZE * SIZE; i++) {
+        for (uint32_t c{0}; c < 3; c++) {
+            // Tensor channel c is B, G, R; ARGB is B, G, R, A in memory.
+            const uint32_t colour{2 - c};
+            const float expected{(static_cast<float>(argb[4 * i + c]) / 255.0f - parameters.mean[colour]) / parameters.stddev[colour]};
+            uint16_t bits{0};
+            std::memcpy(&bits, &float16[TensorHeader::DATA_OFFSET + 2 * (c * SIZE * SIZE + i)], sizeof(bits));
+            nearest   = nearest && nearestFloat16(bits, expected);
+            subnormal = subnormal || ((0 != (bits & 0x7FFFu)) && (0 == (bits & 0x7C00u)));
+        }
+    }
+    check(subnormal, "float16 test covers subnormal values");
+    check(nearest, "float16 elements are the nearest float16 of the normalised values");
+}
+
+/**
+ * Resizes a random image into a tensor of another aspect ratio and compares
+ * it with bilinear interpolation in floating point at pixel centres.
+ */
+void letterbox(uint32_t width, uint32_t height, const TensorWriter::Parameters &parameters, uint32_t workers, uint32_t left, uint32_t top,
+               uint32_t scaledWidth, uint32_t scaledHeight) {
+    const std::string name{std::to_string(width) + "x" + std::to_string(height) + " into " + std::to_string(parameters.width) + "x" +
+                           std::to_string(parameters.height) + ((TensorType::FLOAT16 == parameters.type) ? " float16" : " uint8") +
+                           (parameters.bgr ? " BGR" : " RGB")};
+    std::mt19937 generator{width * 100 + height};
+    std::uniform_int_distribution<uint32_t> value{0, 255};
+    std::vector<uint8_t> argb(4 * width * height);
+    for (uint8_t &byte : argb) {
+        byte = static_cast<uint8_t>(value(generator));
+    }
+    const std::vector<uint8_t> tensor{write(argb, width, height, parameters, workers)};
+
+    TensorHeader header{};
+    std::memcpy(&header, tensor.data(), sizeof(header));
+    check((TensorHeader::VERSION == header.version) && (static_cast<uint32_t>(parameters.type) == header.type) && (3 == header.channels) &&
+              (parameters.width == header.width) && (parameters.height == header.height) && ((parameters.bgr ? 1u : 0u) == header.bgr),
+          name + ": header describes the tensor");
+    check((left == header.left) && (top == header.top), name + ": image is centred");
+
+    auto position = [](uint32_t i, uint32_t sourceSize, uint32_t size, uint32_t &first, uint32_t &second, double &weight) {
+        const double p{std::min(std::max((i + 0.5) * sourceSize / size - 0.5, 0.0), sourceSize - 1.0)};
+        first  = static_cast<uint32_t>(p);
+        second = std::min(first + 1, sourceSize - 1);
+        weight = p - first;
+    };
+    const bool float16{TensorType::FLOAT16 == parameters.type};
+    double worst{0.0};
+    bool padded{true};
+    for (uint32_t c{0}; c < 3; c++) {
+        const uint32_t colour{parameters.bgr ? 2 - c : c};
+        // Offset of the colour in an ARGB pixel.
+        const uint32_t byte{2 - colour};
+        auto normalised = [&](double v) {
+            return float16 ? (v / 255.0 - parameters.mean[colour]) / parameters.stddev[colour] : v;
+        };
+        for (uint32_t y{0}; y < parameters.height; y++) {
+            for (uint32_t x{0}; x < parameters.width; x++) {
+                const double actual{element(tensor, parameters, c, x, y)};
+                if ((x < left) || (x >= left + scaledWidth) || (y < top) || (y >= top + scaledHeight)) {
+                    padded = padded && (std::fabs(actual - normalised(parameters.pad)) < 1e-3);
+                    continue;
+                }
+                uint32_t x0{0}, x1{0}, y0{0}, y1{0};
+                double wx{0.0}, wy{0.0};
+                position(x - left, width, scaledWidth, x0, x1, wx);
+                position(y - top, height, scaledHeight, y0, y1, wy);
+                auto at = [&](uint32_t column, uint32_t row) {
+                    return static_cast<double>(argb[4 * (row * width + column) + byte]);
+                };
+                const double expected{(1.0 - wy) * ((1.0 - wx) * at(x0, y0) + wx * at(x1, y0)) + wy * ((1.0 - wx) * at(x0, y1) + wx * at(x1, y1))};
+                // In units of image values.
+                const double error{std::fabs(actual - normalised(expected)) * (float16 ? 255.0 * parameters.stddev[colour] : 1.0)};
+                worst = std::max(worst, error);
+            }
+        }
+    }
+    // Weights in 1/256 and rounding to 8 bit cost up to one value; float16
+    // adds half a step of its 11 bit mantissa.
+    check(worst <= (float16 ? 1.1 : 1.0), name + ": within one value of the bilinear reference (" + std::to_string(worst) + ")");
+    check(padded, name + ": padding holds the pad value");
+}
+
+} // namespace
+
+int32_t main() {
+    exactValues();
+
+    TensorWriter::Parameters parameters;
+    // Wide image: bars above and below.
+    parameters.width  = 24;
+    parameters.height = 20;
+    letterbox(40, 30, parameters, 1, 0, 1, 24, 18);
+    letterbox(40, 30, parameters, 4, 0, 1, 24, 18);
+    // Tall image: bars left and right; enlarged.
+    parameters.width  = 32;
+    parameters.height = 32;
+    parameters.bgr    = true;
+    parameters.pad    = 0;
+    letterbox(15, 20, parameters, 3, 4, 0, 24, 32);
+
+    parameters.type      = TensorType::FLOAT16;
+    parameters.mean[0]   = 0.485f;
+    parameters.mean[1]   = 0.456f;
+    parameters.mean[2]   = 0.406f;
+    parameters.stddev[0] = 0.229f;
+    parameters.stddev[1] = 0.224f;
+    parameters.stddev[2] = 0.225f;
+    parameters.pad       = 114;
+    letterbox(15, 20, parameters, 3, 4, 0, 24, 32);
+    parameters.bgr    = false;
+    parameters.width  = 24;
+    parameters.height = 20;
+    letterbox(40, 30, parameters, 2, 0, 1, 24, 18);
+    return (0 == failures) ? 0 : 1;
+}
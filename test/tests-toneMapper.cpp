@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2018  Christian Berger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline/bayerConverter.h"
+#include "pipeline/bayerCorrection.h"
+#include "pipeline/toneMapper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const uint32_t WIDTH{64};
+const uint32_t HEIGHT{48};
+const uint32_t TILES{4};
+
+int failures{0};
+
+void check(bool condition, const std::string &what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+/**
+ * Brightens to the right and, less so, downwards.
+ */
+std::vector<uint16_t> ramp() {
+    std::vector<uint16_t> samples(WIDTH * HEIGHT);
+    for (uint32_t y{0}; y < HEIGHT; y++) {
+        for (uint32_t x{0}; x < WIDTH; x++) {
+            samples[y * WIDTH + x] = static_cast<uint16_t>(256 + x * 900 + y * 50);
+        }
+    }
+    return samples;
+}
+
+bool lutEquals(const ToneMapper &toneMapper, float compression, double gain) {
+    const double last{(1u << ToneMapper::LUT_BITS) - 1.0};
+    bool equal{true};
+    for (uint32_t i{0}; i < (1u << ToneMapper::LUT_BITS); i++) {
+        const double x{gain * i / last};
+        const double y{(compression > 0.0f) ? std::log1p(compression * x) / std::log1p(compression) : x};
+        const long expected{std::lround(255.0 * std::min(y, 1.0))};
+        // The table is computed in float.
+        equal = equal && (std::labs(toneMapper.lut()[i] - expected) <= 1);
+    }
+    return equal;
+}
+
+void globalCurve() {
+    WorkerPool workers{1};
+    ToneMapper linear{0.0f, 0.0f, 0, 0.0f, WIDTH, HEIGHT, workers};
+    check(lutEquals(linear, 0.0f, 1.0), "compression 0 is linear");
+    check((0 == linear.lut()[0]) && (255 == linear.lut()[(1u << ToneMapper::LUT_BITS) - 1]), "linear table spans [0, 255]");
+
+    ToneMapper toneMapper{8.0f, 0.010f, 0, 0.0f, WIDTH, HEIGHT, workers};
+    check(lutEquals(toneMapper, 8.0f, 1.0), "logarithmic curve before the first exposure");
+    toneMapper.update(0.020f);
+    check(lutEquals(toneMapper, 8.0f, 0.5), "twice the reference exposure halves the input");
+    toneMapper.update(0.0201f);
+    check(lutEquals(toneMapper, 8.0f, 0.5), "exposure changes within 1% keep the table");
+    toneMapper.update(0.0205f);
+    check(lutEquals(toneMapper, 8.0f, 0.010 / 0.0205), "exposure changes beyond 1% rebuild the table");
+
+    // Without tiles, a row is mapped through the table alone.
+    const std::vector<uint16_t> samples{ramp()};
+    std::vector<uint8_t> mapped(WIDTH);
+    std::vector<uint16_t> scratch(WIDTH);
+    toneMapper.map(samples.data() + 5 * WIDTH, 5, mapped.data(), scratch.data());
+    bool equal{true};
+    for (uint32_t x{0}; x < WIDTH; x++) {
+        equal = equal && (mapped[x] == toneMapper.lut()[samples[5 * WIDTH + x] >> (16 - ToneMapper::LUT_BITS)]);
+    }
+    check(equal, "without tiles, samples are looked up by their upper bits");
+}
+
+/**
+ * Position of coordinate c between the centres of TILES tiles.
+ */
+void tilePosition(uint32_t c, uint32_t size, uint32_t &tile, double &weight) {
+    const double position{std::min(std::max((c + 0.5) * TILES / size - 0.5, 0.0), TILES - 1.0)};
+    tile   = static_cast<uint32_t>(position);
+    weight = position - tile;
+}
+
+void localOperator() {
+    const float STRENGTH{0.7f};
+    const std::vector<uint16_t> samples{ramp()};
+
+    // Tile means of every 8th 2x2 cell and the gains they give.
+    double sums[TILES * TILES]{};
+    double counts[TILES * TILES]{};
+    for (uint32_t y{0}; y + 1 < HEIGHT; y += 8) {
+        for (uint32_t x{0}; x + 1 < WIDTH; x += 8) {
+            const uint32_t tile{std::min(y * TILES / HEIGHT, TILES - 1) * TILES + std::min(x * TILES / WIDTH, TILES - 1)};
+            sums[tile] += samples[y * WIDTH + x] + samples[y * WIDTH + x + 1] + samples[(y + 1) * WIDTH + x] + samples[(y + 1) * WIDTH + x + 1];
+            counts[tile]++;
+        }
+    }
+    double frameSum{0.0};
+    double frameCount{0.0};
+    for (uint32_t t{0}; t < TILES * TILES; t++) {
+        frameSum += sums[t];
+        frameCount += counts[t];
+    }
+    double gains[TILES * TILES]{};
+    for (uint32_t t{0}; t < TILES * TILES; t++) {
+        const double gain{std::pow((frameSum / frameCount) / (sums[t] / counts[t]), static_cast<double>(STRENGTH))};
+        gains[t] = std::lround(std::min(std::max(gain, 0.25), 4.0) * (1u << ToneMapper::GAIN_BITS));
+    }
+
+    // Measuring in one or in three stripes gives the same gains.
+    for (const uint32_t stripes : {1u, 3u}) {
+        const std::string name{std::to_string(stripes) + " stripes"};
+        WorkerPool workers{stripes};
+        ToneMapper toneMapper{4.0f, 0.0f, TILES, STRENGTH, WIDTH, HEIGHT, workers};
+        for (uint32_t s{0}; s < stripes; s++) {
+            // Stripes of whole row pairs, like the converters use.
+            toneMapper.measure(samples.data(), 2 * (HEIGHT / 2 * s / stripes), 2 * (HEIGHT / 2 * (s + 1) / stripes), s);
+        }
+        toneMapper.finishMeasuring();
+
+        double worst{0.0};
+        bool mapped{true};
+        std::vector<uint16_t> gainRow(WIDTH);
+        std::vector<uint16_t> scratch(WIDTH);
+        std::vector<uint8_t> row(WIDTH);
+        for (uint32_t y{0}; y < HEIGHT; y++) {
+            toneMapper.gainRow(y, gainRow.data());
+            uint32_t tileRow{0};
+            double wy{0.0};
+            tilePosition(y, HEIGHT, tileRow, wy);
+            const uint32_t nextRow{std::min(tileRow + 1, TILES - 1)};
+            for (uint32_t x{0}; x < WIDTH; x++) {
+                uint32_t tileColumn{0};
+                double wx{0.0};
+                tilePosition(x, WIDTH, tileColumn, wx);
+                const uint32_t nextColumn{std::min(tileColumn + 1, TILES - 1)};
+                const double expected{(1.0 - wy) * ((1.0 - wx) * gains[tileRow * TILES + tileColumn] + wx * gains[tileRow * TILES + nextColumn]) +
+                                      wy * ((1.0 - wx) * gains[nextRow * TILES + tileColumn] + wx * gains[nextRow * TILES + nextColumn])};
+                worst = std::max(worst, std::fabs(gainRow[x] - expected));
+            }
+            toneMapper.map(samples.data() + y * WIDTH, y, row.data(), scratch.data());
+            for (uint32_t x{0}; x < WIDTH; x++) {
+                const uint32_t scaled{std::min((static_cast<uint32_t>(samples[y * WIDTH + x]) * gainRow[x]) >> ToneMapper::GAIN_BITS, 0xFFFFu)};
+                mapped = mapped && (row[x] == toneMapper.lut()[scaled >> (16 - ToneMapper::LUT_BITS)]);
+            }
+        }
+        // Both blends round to 1/256.
+        check(worst <= 2.0, name + ": tile gains are interpolated bilinearly between tile centres (" + std::to_string(worst) + ")");
+        check(mapped, name + ": samples are scaled by their gain before the lookup");
+        check(gainRow[0] > gainRow[WIDTH - 1], name + ": the dark side is brightened relative to the bright side");
+    }
+}
+
+/**
+ * The local operator must measure the samples it maps: a frame converted
+ * with a black level correction equals the same frame corrected up front
+ * and converted without one.
+ */
+void measuredAfterCorrection() {
+    const uint32_t BLACK{12000};
+    const std::vector<uint16_t> samples{ramp()};
+    BayerCorrection correction{WIDTH, HEIGHT, 0xFFFFu, BLACK};
+    std::vector<uint16_t> corrected(WIDTH * HEIGHT);
+    std::vector<uint16_t> gains(WIDTH);
+    for (uint32_t y{0}; y < HEIGHT; y++) {
+        correction.correct(samples.data() + y * WIDTH, y, corrected.data() + y * WIDTH, gains.data());
+    }
+
+    auto convert = [](const std::vector<uint16_t> &frame, const BayerCorrection *frameCorrection, uint32_t stripes) {
+        std::vector<uint8_t> bigEndian(2 * frame.size());
+        for (std::size_t i{0}; i < frame.size(); i++) {
+            bigEndian[2 * i]     = static_cast<uint8_t>(frame[i] >> 8);
+            bigEndian[2 * i + 1] = static_cast<uint8_t>(frame[i]);
+        }
+        WorkerPool workers{stripes};
+        ToneMapper toneMapper{4.0f, 0.0f, TILES, 0.8f, WIDTH, HEIGHT, workers};
+        BayerConverter converter{WIDTH, HEIGHT, BayerFormat::BAYER16, BayerPattern::RGGB, Demosaic::BILINEAR, workers,
+                                 YuvMatrix::BT601, YuvRange::LIMITED, nullptr, &toneMapper, frameCorrection};
+        std::vector<uint8_t> i420(WIDTH * HEIGHT * 3 / 2);
+        std::vector<uint8_t> argb(4 * WIDTH * HEIGHT);
+        converter.convert(bigEndian.data(), i420.data(), i420.data() + WIDTH * HEIGHT, i420.data() + WIDTH * HEIGHT * 5 / 4, argb.data());
+        return argb;
+    };
+    for (const uint32_t stripes : {1u, 3u}) {
+        check(convert(samples, &correction, stripes) == convert(corrected, nullptr, stripes),
+              std::to_string(stripes) + " stripes: tiles are measured after the correction");
+    }
+}
+
+} // namespace
+
+int32_t main() {
+    globalCurve();
+    localOperator();
+    measuredAfterCorrection();
+    return (0 == failures) ? 0 : 1;
+}